@@ -0,0 +1,164 @@
+#include "precomp.h"
+#include "bit_grid.h"
+
+namespace Tmpl8 {
+
+// Words past the last row, so the 4 word loads never leave the arrays
+constexpr int tail_words = 4;
+
+static int count_trailing_zeros(uint64_t word) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, word);
+  return (int)index;
+#else
+  return __builtin_ctzll(word);
+#endif
+}
+
+#ifdef __AVX2__
+static __m256i load_words(const uint64_t *words) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words));
+}
+#endif
+
+void BitGrid::init(int width, int height) {
+  this->width = width;
+  this->height = height;
+  words_per_row = width / 64 + 1;
+  first_word = 1 + words_per_row;
+  last_word = first_word + words_per_row * height;
+
+  const int num_words = last_word + words_per_row + tail_words;
+  accessible.assign(num_words, 0);
+  inside.assign(num_words, 0);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      inside[word_of(x, y)] |= uint64_t(1) << (x & 63);
+    }
+  }
+}
+
+void BitGrid::set_accessible(int tile, bool accessible) {
+  const int x = tile % width;
+  const uint64_t bit = uint64_t(1) << (x & 63);
+  uint64_t &word = this->accessible[word_of(x, tile / width)];
+  word = accessible ? (word | bit) : (word & ~bit);
+}
+
+// next = every tile next to the frontier that was not reached before.
+// Returns whether there is any.
+bool BitGrid::expand(const uint64_t *frontier, const uint64_t *reached,
+                     uint64_t *next) const {
+  const uint64_t *in_grid = inside.data();
+  int word = first_word;
+  uint64_t any = 0;
+
+#ifdef __AVX2__
+  __m256i any_wide = _mm256_setzero_si256();
+  for (; word + 4 <= last_word; word += 4) {
+    const __m256i current = load_words(frontier + word);
+    const __m256i before = load_words(frontier + word - 1);
+    const __m256i after = load_words(frontier + word + 1);
+    const __m256i above = load_words(frontier + word - words_per_row);
+    const __m256i below = load_words(frontier + word + words_per_row);
+
+    __m256i spread = _mm256_or_si256(_mm256_slli_epi64(current, 1),
+                                     _mm256_srli_epi64(before, 63));
+    spread = _mm256_or_si256(spread, _mm256_srli_epi64(current, 1));
+    spread = _mm256_or_si256(spread, _mm256_slli_epi64(after, 63));
+    spread = _mm256_or_si256(spread, _mm256_or_si256(above, below));
+
+    const __m256i result =
+        _mm256_andnot_si256(load_words(reached + word),
+                            _mm256_and_si256(spread, load_words(in_grid + word)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(next + word), result);
+    any_wide = _mm256_or_si256(any_wide, result);
+  }
+  any = !_mm256_testz_si256(any_wide, any_wide);
+#endif
+
+  for (; word < last_word; word++) {
+    const uint64_t current = frontier[word];
+    const uint64_t spread = (current << 1) | (frontier[word - 1] >> 63) |
+                            (current >> 1) | (frontier[word + 1] << 63) |
+                            frontier[word - words_per_row] |
+                            frontier[word + words_per_row];
+    next[word] = spread & in_grid[word] & ~reached[word];
+    any |= next[word];
+  }
+  return any != 0;
+}
+
+// Breadth first from all targets at once. Every step expands the whole
+// frontier, only the accessible tiles of a layer form the next frontier.
+// visit(tile, distance) is called once per reached tile, layer by layer.
+template <typename Visit>
+void BitGrid::spread(SearchContext &context, const std::vector<int> &targets,
+                     const Visit &visit) const {
+  std::vector<uint64_t> &frontier = context.frontier_bits;
+  std::vector<uint64_t> &reached = context.reached_bits;
+  std::vector<uint64_t> &next = context.next_bits;
+  frontier.assign(accessible.size(), 0);
+  reached.assign(accessible.size(), 0);
+  next.assign(accessible.size(), 0);
+
+  for (int target : targets) {
+    const int word = word_of(target % width, target / width);
+    const uint64_t bit = uint64_t(1) << ((target % width) & 63);
+    if ((accessible[word] & bit) && !(reached[word] & bit)) {
+      frontier[word] |= bit;
+      reached[word] |= bit;
+      visit(target, 0);
+    }
+  }
+
+  for (int distance = 1;
+       expand(frontier.data(), reached.data(), next.data()); distance++) {
+    for (int word = first_word; word < last_word; word++) {
+      uint64_t layer = next[word];
+      reached[word] |= layer;
+      frontier[word] = layer & accessible[word];
+
+      const int y = (word - first_word) / words_per_row;
+      const int x_base = ((word - first_word) % words_per_row) * 64;
+      while (layer != 0) {
+        visit(y * width + x_base + count_trailing_zeros(layer), distance);
+        layer &= layer - 1;
+      }
+    }
+  }
+}
+
+// The previous layer is complete when a tile is visited, any accessible
+// neighbour one step closer is a shortest way on
+void BitGrid::build_flow_field(SearchContext &context,
+                               const std::vector<int> &targets,
+                               FlowField &field) const {
+  field.next.assign(width * height, -1);
+  field.distance.assign(width * height, -1);
+
+  spread(context, targets, [this, &field](int tile, int steps) {
+    field.distance[tile] = steps;
+    if (steps == 0) {
+      field.next[tile] = tile;
+      return;
+    }
+
+    const int x = tile % width;
+    const int y = tile / width;
+    const int neighbours[4] = {x + 1 < width ? tile + 1 : -1,
+                               x > 0 ? tile - 1 : -1,
+                               y + 1 < height ? tile + width : -1,
+                               y > 0 ? tile - width : -1};
+    for (int neighbour : neighbours) {
+      if (neighbour >= 0 && field.distance[neighbour] == steps - 1 &&
+          test(accessible, neighbour)) {
+        field.next[tile] = neighbour;
+        break;
+      }
+    }
+  });
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,51 @@
+#pragma once
+
+namespace Tmpl8 {
+class SearchContext;
+struct FlowField;
+
+// Accessible tiles as one flat bitset for bit-parallel BFS. A row takes
+// whole 64 bit words with at least one spare bit at the end, and the grid
+// is surrounded by empty words, so stepping to any neighbour is a shift by
+// one bit (left and right) or by one row of words (up and down). Expanding
+// the whole frontier one step is then a handful of word operations per 64
+// tiles, done 4 words at a time with AVX2 where available.
+class BitGrid {
+public:
+  void init(int width, int height);
+  void set_accessible(int tile, bool accessible);
+
+  // Flow field towards the nearest of the targets, distance counts steps.
+  // All targets are expanded at once, one distance layer per step. Like the
+  // Dijkstra fields, inaccessible tiles get a distance but are never stepped
+  // onto, and inaccessible targets are ignored.
+  void build_flow_field(SearchContext &context,
+                        const std::vector<int> &targets,
+                        FlowField &field) const;
+
+private:
+  template <typename Visit>
+  void spread(SearchContext &context, const std::vector<int> &targets,
+              const Visit &visit) const;
+  bool expand(const uint64_t *frontier, const uint64_t *reached,
+              uint64_t *next) const;
+
+  int word_of(int x, int y) const {
+    return first_word + y * words_per_row + (x >> 6);
+  }
+  bool test(const std::vector<uint64_t> &bits, int tile) const {
+    const int word = word_of(tile % width, tile / width);
+    return (bits[word] >> ((tile % width) & 63)) & 1;
+  }
+
+  int width = 0;
+  int height = 0;
+  int words_per_row = 0;
+  int first_word = 0; // Of the first row, after one guard word and row
+  int last_word = 0;  // One past the last row
+
+  std::vector<uint64_t> accessible;
+  std::vector<uint64_t> inside; // Every tile of the grid, no padding
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,35 @@
+#pragma once
+
+namespace Tmpl8 {
+
+struct DamageCommand {
+  int tank;
+  int damage;
+};
+
+// Side effects recorded by one task of a parallel stage.
+// Tasks only read the shared game state and write their commands here, the
+// game applies all buffers in task order once the stage is done. Tasks cover
+// consecutive ranges, so the result is the same as a serial run no matter how
+// many threads there are.
+class CommandBuffer {
+public:
+  void spawn_explosion(vec2 position) { explosions.push_back(position); }
+  void apply_damage(int tank, int damage) {
+    damage_commands.push_back({tank, damage});
+  }
+  void spawn_rocket(const Rocket &rocket) { rockets.push_back(rocket); }
+
+  // Keeps the allocated memory for the next frame
+  void clear() {
+    explosions.clear();
+    damage_commands.clear();
+    rockets.clear();
+  }
+
+  std::vector<vec2> explosions;
+  std::vector<DamageCommand> damage_commands;
+  std::vector<Rocket> rockets;
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,259 @@
+#include "precomp.h"
+#include "convex_hull.h"
+
+namespace Tmpl8 {
+
+// Tanks closer than this to the hull boundary are candidates for the next
+// frames, a rebuild is needed once tanks moved half of it
+constexpr float candidate_margin = 24.f;
+
+static bool position_less(const TankStore &tanks, int a, int b) {
+  return tanks.position_x[a] < tanks.position_x[b] ||
+         (tanks.position_x[a] == tanks.position_x[b] &&
+          tanks.position_y[a] < tanks.position_y[b]);
+}
+
+// Positive when a, b, c make a counter clockwise turn
+static float cross(vec2 a, vec2 b, vec2 c) {
+  return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+void ConvexHull::update(const TankStore &tanks, float max_step) {
+  moved_since_rebuild += max_step;
+
+  if (!can_use_candidates(tanks)) {
+    rebuild(tanks);
+    return;
+  }
+
+  // Drop destroyed candidates and restore the order, the tanks barely moved
+  // so insertion sort is close to linear
+  candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                  [&tanks](int tank) {
+                                    return !tanks.is_active(tank);
+                                  }),
+                   candidates.end());
+  for (size_t i = 1; i < candidates.size(); i++) {
+    const int tank = candidates[i];
+    size_t j = i;
+    while (j > 0 && position_less(tanks, tank, candidates[j - 1])) {
+      candidates[j] = candidates[j - 1];
+      j--;
+    }
+    candidates[j] = tank;
+  }
+
+  build_hull(tanks, candidates);
+}
+
+bool ConvexHull::can_use_candidates(const TankStore &tanks) const {
+  if (!has_candidates || moved_since_rebuild > candidate_margin * 0.5f)
+    return false;
+
+  for (int tank : rebuild_vertex_tanks) {
+    if (!tanks.is_active(tank))
+      return false;
+  }
+  return true;
+}
+
+void ConvexHull::rebuild(const TankStore &tanks) {
+  sorted_tanks.clear();
+  for (int tank = 0; tank < tanks.size(); tank++) {
+    if (tanks.is_active(tank)) {
+      sorted_tanks.push_back(tank);
+    }
+  }
+  std::sort(sorted_tanks.begin(), sorted_tanks.end(),
+            [&tanks](int a, int b) { return position_less(tanks, a, b); });
+
+  build_hull(tanks, sorted_tanks);
+
+  rebuild_vertex_tanks = vertex_tanks;
+  moved_since_rebuild = 0.f;
+  has_candidates = vertices.size() >= 3;
+  candidates.clear();
+  if (!has_candidates)
+    return;
+
+  // A tank is at least the margin inside the hull exactly when it lies in the
+  // hull shrunk by the margin, an O(log h) test. The tanks outside of it are
+  // near the boundary.
+  build_inset(candidate_margin, candidate_inset);
+  for (int tank : sorted_tanks) {
+    if (!inside(candidate_inset, tanks.get_position(tank))) {
+      candidates.push_back(tank);
+    }
+  }
+}
+
+// Andrew's monotone chain over tanks sorted on x (then y): build the lower and
+// the upper hull by dropping every point that does not make a left turn.
+void ConvexHull::build_hull(const TankStore &tanks,
+                            const std::vector<int> &sorted_tanks) {
+  vertices.clear();
+  vertex_tanks.clear();
+
+  const int num_points = (int)sorted_tanks.size();
+  if (num_points < 3) {
+    for (int tank : sorted_tanks) {
+      vertices.push_back(tanks.get_position(tank));
+      vertex_tanks.push_back(tank);
+    }
+    return;
+  }
+
+  auto add_point = [this, &tanks](int tank, size_t min_size) {
+    const vec2 position = tanks.get_position(tank);
+    while (vertices.size() >= min_size &&
+           cross(vertices[vertices.size() - 2], vertices.back(), position) <=
+               0.f) {
+      vertices.pop_back();
+      vertex_tanks.pop_back();
+    }
+    vertices.push_back(position);
+    vertex_tanks.push_back(tank);
+  };
+
+  // Lower hull
+  for (int i = 0; i < num_points; i++) {
+    add_point(sorted_tanks[i], 2);
+  }
+
+  // Upper hull, the last point equals the first one
+  const size_t lower_size = vertices.size() + 1;
+  for (int i = num_points - 2; i >= 0; i--) {
+    add_point(sorted_tanks[i], lower_size);
+  }
+  vertices.pop_back();
+  vertex_tanks.pop_back();
+
+  // Unit normals pointing inwards, every inset of this hull reuses them
+  edge_normals.clear();
+  for (size_t i = 0; i < vertices.size(); i++) {
+    const vec2 edge = vertices[(i + 1) % vertices.size()] - vertices[i];
+    edge_normals.push_back(vec2(-edge.y, edge.x).normalized());
+  }
+}
+
+// The point is not strictly on the inner (left) side of the line
+bool ConvexHull::outside_of(const Line &line, vec2 point) {
+  vec2 to_point = point - line.point;
+  return line.direction.x * to_point.y - line.direction.y * to_point.x <= 0.f;
+}
+
+vec2 ConvexHull::intersect(const Line &a, const Line &b) {
+  vec2 between = b.point - a.point;
+  float t = (b.direction.x * between.y - b.direction.y * between.x) /
+            (b.direction.x * a.direction.y - b.direction.y * a.direction.x);
+  return a.point + a.direction * t;
+}
+
+// Half plane intersection of the hull edges moved inwards by margin.
+// The edges are sorted on angle, so a deque pass is enough: a new edge drops
+// the corners at both ends of the deque that lie outside of it, afterwards the
+// ends are trimmed against each other. Less than 3 lines left means the hull
+// is thinner than two times the margin.
+void ConvexHull::prepare_containment(float margin) {
+  containment_margin = margin;
+  build_inset(margin, inset_vertices);
+}
+
+void ConvexHull::build_inset(float margin, std::vector<vec2> &inset) {
+  inset.clear();
+  inset_lines.clear();
+  if (vertices.size() < 3)
+    return;
+
+  for (size_t i = 0; i < vertices.size(); i++) {
+    vec2 direction = vertices[(i + 1) % vertices.size()] - vertices[i];
+    inset_lines.push_back({vertices[i] + edge_normals[i] * margin, direction});
+  }
+  std::sort(inset_lines.begin(), inset_lines.end(),
+            [](const Line &a, const Line &b) {
+              return atan2f(a.direction.y, a.direction.x) <
+                     atan2f(b.direction.y, b.direction.x);
+            });
+
+  inset_deque.resize(inset_lines.size());
+  int front = 0;
+  int back = -1;
+  for (const Line &line : inset_lines) {
+    while (back - front >= 1 &&
+           outside_of(line, intersect(inset_deque[back], inset_deque[back - 1]))) {
+      back--;
+    }
+    while (back - front >= 1 &&
+           outside_of(line, intersect(inset_deque[front], inset_deque[front + 1]))) {
+      front++;
+    }
+    inset_deque[++back] = line;
+  }
+  while (back - front >= 2 &&
+         outside_of(inset_deque[front],
+                    intersect(inset_deque[back], inset_deque[back - 1]))) {
+    back--;
+  }
+  while (back - front >= 2 &&
+         outside_of(inset_deque[back],
+                    intersect(inset_deque[front], inset_deque[front + 1]))) {
+    front++;
+  }
+  if (back - front < 2)
+    return;
+
+  for (int i = front; i <= back; i++) {
+    const Line &next = inset_deque[(i == back) ? front : i + 1];
+    inset.push_back(intersect(inset_deque[i], next));
+  }
+}
+
+bool ConvexHull::contains(vec2 point) const {
+  return inside(inset_vertices, point);
+}
+
+bool ConvexHull::touches(vec2 point) const {
+  if (vertices.size() >= 3)
+    return !contains(point);
+  if (vertices.empty())
+    return false;
+
+  // Closest point of the segment (or the single vertex)
+  vec2 start = vertices.front();
+  vec2 segment = vertices.back() - start;
+  const float sqr_length = segment.sqr_length();
+  const float t =
+      (sqr_length > 0.f)
+          ? clamp((point - start).dot(segment) / sqr_length, 0.f, 1.f)
+          : 0.f;
+  return (start + segment * t - point).sqr_length() <=
+         containment_margin * containment_margin;
+}
+
+bool ConvexHull::inside(const std::vector<vec2> &polygon, vec2 point) {
+  const int num_vertices = (int)polygon.size();
+  if (num_vertices < 3)
+    return false;
+
+  // Outside of the fan spanned from the first vertex
+  const vec2 apex = polygon[0];
+  if (cross(apex, polygon[1], point) <= 0.f ||
+      cross(apex, polygon[num_vertices - 1], point) >= 0.f)
+    return false;
+
+  // Find the triangle (apex, low, low + 1) holding the point
+  int low = 1;
+  int high = num_vertices - 1;
+  while (high - low > 1) {
+    const int mid = (low + high) / 2;
+    if (cross(apex, polygon[mid], point) > 0.f) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+
+  return cross(polygon[low], polygon[low + 1], point) > 0.f;
+}
+
+} // namespace Tmpl8
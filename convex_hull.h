@@ -0,0 +1,83 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// Convex hull around all active tanks, updated incrementally.
+// A full rebuild (Andrew's monotone chain over all tanks) also collects the
+// candidates: the tanks closer than a margin to the hull boundary. Tanks that
+// are deeper inside can only reach the boundary after the army moved for a
+// while, so the following frames only recompute the hull over the candidates.
+//
+// Rebuilds find the candidates with the same test, against the hull shrunk
+// by the candidate margin.
+//
+// The candidate hull is correct as long as:
+// - all vertices of the rebuilt hull are still alive, and
+// - no tank moved more than half the margin since the rebuild.
+// The hull of the moved vertices then still contains every point that was at
+// least half the margin deep, which holds every non candidate. Once either
+// condition fails the hull is rebuilt from all tanks.
+//
+// For point queries the hull is shrunk by a margin (the edges moved inwards,
+// intersected as half planes) and split into a fan of triangles around its
+// first vertex. A binary search over the fan finds the one triangle, and thus
+// the one edge, a point has to be tested against.
+class ConvexHull {
+public:
+  // max_step is the largest distance any tank moved since the last update
+  void update(const TankStore &tanks, float max_step);
+
+  // Hull vertices in counter clockwise order (for a y-up coordinate system)
+  const std::vector<vec2> &get_vertices() const { return vertices; }
+
+  // Shrink the hull by margin for contains(), once per frame after update
+  void prepare_containment(float margin);
+
+  // Is the point more than the margin inside the hull? In other words, does a
+  // circle with radius margin around it lie completely inside? O(log h)
+  bool contains(vec2 point) const;
+
+  // Does a circle with radius margin around the point touch the hull? With 3
+  // or more vertices that is anything not contained. A hull of one or two
+  // tanks has no inside, only circles that reach its point or segment touch.
+  bool touches(vec2 point) const;
+
+private:
+  struct Line {
+    vec2 point;
+    vec2 direction; // The inside is on the left
+  };
+
+  static bool outside_of(const Line &line, vec2 point);
+  static vec2 intersect(const Line &a, const Line &b);
+  // Is the point strictly inside the convex polygon (counter clockwise)?
+  static bool inside(const std::vector<vec2> &polygon, vec2 point);
+
+  // The hull shrunk by margin, empty when it is thinner than twice the margin
+  void build_inset(float margin, std::vector<vec2> &inset);
+
+  void rebuild(const TankStore &tanks);
+  void build_hull(const TankStore &tanks, const std::vector<int> &sorted_tanks);
+  bool can_use_candidates(const TankStore &tanks) const;
+
+  std::vector<vec2> vertices;
+  std::vector<int> vertex_tanks;
+  std::vector<vec2> edge_normals; // Unit, inwards, edge i starts at vertex i
+
+  // Candidates sorted on position, kept sorted between frames
+  std::vector<int> candidates;
+  std::vector<int> rebuild_vertex_tanks;
+  float moved_since_rebuild = 0.f;
+  bool has_candidates = false;
+  std::vector<vec2> candidate_inset;
+
+  std::vector<int> sorted_tanks;
+
+  // Hull shrunk by the containment margin, also convex
+  float containment_margin = 0.f;
+  std::vector<Line> inset_lines;
+  std::vector<Line> inset_deque;
+  std::vector<vec2> inset_vertices;
+};
+
+} // namespace Tmpl8
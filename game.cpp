@@ -14,6 +14,12 @@ constexpr auto health_bar_width = 70;
 
 constexpr auto max_frames = 2000;
 
+// Rockets that do not fit in the pool are not fired
+constexpr auto max_rockets = 16384;
+
+// Frames between two rockets of a tank
+constexpr auto rocket_reload_frames = 200;
+
 // Global performance timer
 //  constexpr auto REF_PERFORMANCE = 114757; //UPDATE THIS WITH YOUR REFERENCE
 //  PERFORMANCE (see console after 2k frames) static timer perf_timer; static
@@ -48,6 +54,13 @@ const static vec2 rocket_size(6, 6);
 const static float tank_radius = 3.f;
 const static float rocket_radius = 5.f;
 
+// Grid rows per collision task, fixed so the results do not depend on the
+// number of threads
+constexpr int collision_band_rows = 8;
+
+// Routes of frame 0, reused while terrain and spawns stay the same
+const static char *route_cache_path = "assets/routes.cache";
+
 // -----------------------------------------------------------
 // Initialize the simulation state
 // This function does not count for the performance multiplier
@@ -58,6 +71,11 @@ void Game::init() {
                               "ABCDEFGHIJKLMNOPQRSTUVWXYZ:?!=-0123456789.");
 
   tanks.reserve(num_tanks_blue + num_tanks_red);
+  rockets.init(max_rockets);
+
+  // Cells as large as the collision distance of two tanks
+  tank_grid.resize(vec2(0.f, 0.f), background_terrain.get_size(),
+                   tank_radius * 2.f);
 
   uint max_rows = 24;
 
@@ -73,17 +91,21 @@ void Game::init() {
   for (int i = 0; i < num_tanks_blue; i++) {
     vec2 position{start_blue_x + ((i % max_rows) * spacing),
                   start_blue_y + ((i / max_rows) * spacing)};
-    tanks.push_back(Tank(position.x, position.y, BLUE, &tank_blue, &smoke,
-                         1100.f, position.y + 16, tank_radius, tank_max_health,
-                         tank_max_speed));
+    tanks.add(position, BLUE, &tank_blue, &smoke,
+              vec2(1100.f, position.y + 16), tank_radius, tank_max_health,
+              tank_max_speed);
   }
   // Spawn red tanks
   for (int i = 0; i < num_tanks_red; i++) {
     vec2 position{start_red_x + ((i % max_rows) * spacing),
                   start_red_y + ((i / max_rows) * spacing)};
-    tanks.push_back(Tank(position.x, position.y, RED, &tank_red, &smoke, 100.f,
-                         position.y + 16, tank_radius, tank_max_health,
-                         tank_max_speed));
+    tanks.add(position, RED, &tank_red, &smoke, vec2(100.f, position.y + 16),
+              tank_radius, tank_max_health, tank_max_speed);
+  }
+
+  // Every tank fires in the first frame
+  for (int tank = 0; tank < tanks.size(); tank++) {
+    reload_wheel.schedule(tank, 1);
   }
 
   particle_beams.push_back(Particle_beam(vec2(590, 327), vec2(100, 50),
@@ -99,215 +121,292 @@ void Game::init() {
 
 // -----------------------------------------------------------
 // Close down application
+// Writes the routes the scheduler collected for the route cache, here
+// instead of during a frame
 // -----------------------------------------------------------
-void Game::shutdown() {}
+void Game::shutdown() {
+  if (route_cache_key != 0 && spawn_positions.empty() &&
+      !RouteCache::write(route_cache_path, route_cache_key, spawn_routes)) {
+    std::cout << "Could not write route cache: " << route_cache_path
+              << std::endl;
+  }
+}
 
 // -----------------------------------------------------------
-// Iterates through all tanks and returns the closest enemy tank for the given
-// tank
+// Returns the closest enemy tank for the given tank
+// Uses the k-d tree of the other team, built once per frame in update_tanks,
+// so a query is O(log n) instead of a scan over all tanks
 // -----------------------------------------------------------
-Tank &Game::find_closest_enemy(Tank &current_tank) {
-  float closest_distance = numeric_limits<float>::infinity();
-  int closest_index = 0;
-
-  for (int i = 0; i < tanks.size(); i++) {
-    if (tanks.at(i).allignment != current_tank.allignment &&
-        tanks.at(i).active) {
-      float sqr_dist =
-          fabsf((tanks.at(i).get_position() - current_tank.get_position())
-                    .sqr_length());
-      if (sqr_dist < closest_distance) {
-        closest_distance = sqr_dist;
-        closest_index = i;
-      }
-    }
-  }
-
-  return tanks.at(closest_index);
-}
+int Game::find_closest_enemy(int current_tank) const {
+  const KdTree &enemy_tree =
+      team_trees[(tanks.allignment[current_tank] == RED) ? BLUE : RED];
+  const int closest_index =
+      enemy_tree.find_closest(tanks.get_position(current_tank));
 
-// Checks if a point lies on the left of an arbitrary angled line
-bool Tmpl8::Game::left_of_line(vec2 line_start, vec2 line_end, vec2 point) {
-  return ((line_end.x - line_start.x) * (point.y - line_start.y) -
-          (line_end.y - line_start.y) * (point.x - line_start.x)) < 0;
+  return (closest_index >= 0) ? closest_index : 0;
 }
 
 /**
- * Sweep & Prune Algorithm for Tank Collision Detection
- * Documentation enhanced with ChatGPT
+ * Uniform Grid Broadphase for Tank Collision Detection
  *
  * This algorithm improves collision detection performance by:
- * 1. Projecting objects onto an axis (x-axis)
- * 2. Sorting the start and end points
- * 3. Sweeping through the sorted points
- * 4. Only checking collisions between objects that overlap on the axis
+ * 1. Bucketing all active tanks into a uniform grid (cell size = 2x radius)
+ * 2. Only testing tanks against the tanks in the neighbouring cells
+ * 3. Testing every pair once and pushing both tanks away from each other
  *
- * Time Complexity:
- * - Sorting: O(n log n)
- * - Linear scan: O(n)
+ * Because a cell is as large as the collision distance, every colliding pair
+ * lies in the same cell or in one of its 8 neighbours. Each cell only visits
+ * the forward half of that neighbourhood (right, below left, below, below
+ * right), so every pair is found exactly once.
  *
- * Space Complexity: O(n)
+ * Time Complexity:
+ * - Building the grid: O(n + cells) (counting sort, no comparisons)
+ * - Collision checks: O(n * k), k = average tanks per neighbourhood
  *
- * Advantages:
- * - More efficient than brute force O(n²)
- * - Works well for moving objects
- * - Simple to implement
- * - No complex data structures
+ * Thread Pool Implementation:
+ * - The grid rows are split into bands of collision_band_rows rows
+ * - A cell writes to the tanks in its own row and the row below, so bands
+ *   with the same parity never touch the same tanks
+ * - All even bands run in parallel first, then all odd bands, so no mutex is
+ *   needed and the result does not depend on the number of threads
+ */
+void Game::check_tank_collision_grid() {
+  tank_grid.build(tanks);
+
+  const int columns = tank_grid.get_columns();
+  const int rows = tank_grid.get_rows();
+  const int num_bands = (rows + collision_band_rows - 1) / collision_band_rows;
+  const int num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  // Test all tanks in a cell against the tanks in cell (x, y), push both
+  auto collide_cells = [this, columns, rows](const int *begin, const int *end,
+                                             int x, int y, bool same_cell) {
+    if (x < 0 || x >= columns || y >= rows)
+      return;
+    const int *other_begin = tank_grid.cell_begin(x, y);
+    const int *other_end = tank_grid.cell_end(x, y);
+
+    for (const int *a = begin; a != end; a++) {
+      const vec2 position = tanks.get_position(*a);
+      for (const int *b = same_cell ? a + 1 : other_begin; b != other_end;
+           b++) {
+        vec2 dir = position - tanks.get_position(*b);
+        float min_dist = tanks.collision_radius[*a] + tanks.collision_radius[*b];
+
+        if (dir.sqr_length() < min_dist * min_dist) {
+          vec2 push_dir = dir.normalized();
+          tanks.push(*a, push_dir, 1.f);
+          tanks.push(*b, -push_dir, 1.f);
+        }
+      }
+    }
+  };
+
+  auto collide_band = [this, &collide_cells, columns, rows](int band) {
+    const int first_row = band * collision_band_rows;
+    const int last_row = std::min(first_row + collision_band_rows, rows);
+
+    for (int y = first_row; y < last_row; y++) {
+      for (int x = 0; x < columns; x++) {
+        const int *begin = tank_grid.cell_begin(x, y);
+        const int *end = tank_grid.cell_end(x, y);
+        if (begin == end)
+          continue;
+
+        collide_cells(begin, end, x, y, true);
+        collide_cells(begin, end, x + 1, y, false);
+        collide_cells(begin, end, x - 1, y + 1, false);
+        collide_cells(begin, end, x, y + 1, false);
+        collide_cells(begin, end, x + 1, y + 1, false);
+      }
+    }
+  };
+
+  for (int parity = 0; parity < 2; parity++) {
+    std::vector<std::future<void>> futures;
+
+    // Hand every thread an interleaved set of bands with this parity
+    for (int t = 0; t < num_threads; t++) {
+      futures.push_back(
+          thread_pool.enqueue([&collide_band, parity, t, num_threads,
+                               num_bands]() {
+            for (int band = parity + t * 2; band < num_bands;
+                 band += num_threads * 2) {
+              collide_band(band);
+            }
+          }));
+    }
+
+    // Wait for all tasks to complete before the other parity starts
+    for (auto &future : futures) {
+      future.wait();
+    }
+  }
+}
+
+/**
+ * Persistent Sweep & Prune for Tank Collision Detection
  *
- * Implementation:
- * 1. Create arrays of tank bounds (min and max x-coordinates)
- * 2. Sort bounds by x-coordinate
- * 3. Sweep through sorted bounds
- * 4. Only check collisions between objects that overlap on the axis
+ * Alternative to the uniform grid. The sorted endpoint list and the x-overlap
+ * pairs are kept between frames (see SweepAndPrune), so a frame only costs a
+ * near linear insertion sort plus a narrow phase over the overlapping pairs.
+ * Destroyed tanks are marked in on_tank_destroyed and dropped from the lists
+ * in one pass at the next update. The pairs are walked in the order they
+ * began to overlap, the same in every run.
  *
- * Thread Pool Implementation:
- * - Distributes tank collision checks across multiple CPU cores
- * - Each thread processes a subset of tanks
- * - Uses mutex for thread-safe access to shared resources
- * - Time Complexity: O(n/m) per thread, where n = number of tanks, m = number
- * of threads
+ * Time Complexity:
+ * - Insertion sort on nearly sorted endpoints: O(n + swaps)
+ * - Narrow phase: O(p), p = number of pairs overlapping on the x-axis
+ * - Destroyed tanks: O(n + p) once per frame with any, not per tank
  */
-void Game::check_tank_collision() {
-  // Create arrays of tank bounds (min and max x-coordinates)
-  std::vector<std::pair<float, Tank *>> tank_bounds;
-  tank_bounds.reserve(tanks.size());
-
-  // Fill bounds array with active tanks
-  for (Tank &tank : tanks) {
-    if (tank.active) {
-      float radius = tank.collision_radius;
-      tank_bounds.push_back({tank.position.x - radius, &tank});
-      tank_bounds.push_back({tank.position.x + radius, &tank});
+void Game::check_tank_collision_sweep_and_prune() {
+  sweep_and_prune.update(tanks);
+
+  for (uint64_t pair : sweep_and_prune.get_overlap_pairs()) {
+    const int tank = (int)(pair >> 32);
+    const int other = (int)(pair & 0xffffffff);
+    vec2 dir = tanks.get_position(tank) - tanks.get_position(other);
+    float min_dist = tanks.collision_radius[tank] + tanks.collision_radius[other];
+
+    if (dir.sqr_length() < min_dist * min_dist) {
+      vec2 push_dir = dir.normalized();
+      tanks.push(tank, push_dir, 1.f);
+      tanks.push(other, -push_dir, 1.f);
     }
   }
+}
+
+void Game::check_tank_collision() {
+  switch (collision_mode) {
+  case CollisionMode::UNIFORM_GRID:
+    check_tank_collision_grid();
+    break;
+  case CollisionMode::SWEEP_AND_PRUNE:
+    check_tank_collision_sweep_and_prune();
+    break;
+  }
+}
 
-  // Sort bounds by x-coordinate
-  std::sort(tank_bounds.begin(), tank_bounds.end());
+// Keep the collision structures in sync when a tank dies
+// (called from apply_commands, never from a worker thread)
+void Game::on_tank_destroyed(int tank) {
+  sweep_and_prune.remove(tank);
+  team_trees[tanks.allignment[tank]].remove(tank);
+}
 
-  // Calculate how many bounds per thread
-  const int num_bounds = tank_bounds.size();
-  const int num_threads = std::thread::hardware_concurrency();
-  const int bounds_per_thread =
-      (num_bounds + num_threads - 1) / num_threads; // Ceiling division
+// -----------------------------------------------------------
+// Split [0, count) into one consecutive chunk per thread and run
+// body(begin, end, commands) for every chunk on the thread pool.
+// Afterwards the recorded commands are applied in chunk order, which is the
+// same order a serial loop would have produced them in.
+// -----------------------------------------------------------
+template <typename Body>
+void Game::run_parallel_stage(int count, const Body &body) {
+  const int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  const int per_thread = (count + num_threads - 1) / num_threads;
+  const int num_chunks = (per_thread > 0) ? (count + per_thread - 1) / per_thread : 0;
+
+  if ((int)command_buffers.size() < num_chunks) {
+    command_buffers.resize(num_chunks);
+  }
 
   std::vector<std::future<void>> futures;
+  for (int chunk = 0; chunk < num_chunks; chunk++) {
+    const int begin = chunk * per_thread;
+    const int end = std::min(begin + per_thread, count);
+    CommandBuffer &commands = command_buffers[chunk];
+    commands.clear();
 
-  // Distribute bounds across threads
-  for (int i = 0; i < num_bounds; i += bounds_per_thread) {
-    int end = std::min(i + bounds_per_thread, num_bounds);
-
-    futures.push_back(thread_pool.enqueue([this, i, end, &tank_bounds]() {
-      // Active list of tanks to check for collisions (local to this thread)
-      std::vector<Tank *> active_tanks;
-
-      // Process this thread's portion of bounds
-      for (int j = i; j < end; j++) {
-        const auto &bound = tank_bounds[j];
-        Tank *tank = bound.second;
-
-        // Check if this is a start or end bound
-        if (bound.first == tank->position.x - tank->collision_radius) {
-          // Start bound - add to active list and check against other active
-          // tanks
-          for (Tank *other : active_tanks) {
-            if (tank != other) {
-              // Check y-coordinates for overlap
-              float dy = tank->position.y - other->position.y;
-              float min_y_dist =
-                  tank->collision_radius + other->collision_radius;
-
-              if (dy * dy < min_y_dist * min_y_dist) {
-                // Collision detected - handle it
-                std::lock_guard<std::mutex> lock(game_mutex);
-                tank->push((tank->position - other->position).normalized(),
-                           1.f);
-              }
-            }
-          }
-          active_tanks.push_back(tank);
-        } else {
-          // End bound - remove from active list
-          active_tanks.erase(
-              std::remove(active_tanks.begin(), active_tanks.end(), tank),
-              active_tanks.end());
-        }
-      }
-    }));
+    futures.push_back(thread_pool.enqueue(
+        [&body, begin, end, &commands]() { body(begin, end, commands); }));
   }
 
   // Wait for all tasks to complete
   for (auto &future : futures) {
     future.wait();
   }
-}
 
-void Game::update_tanks() {
-  for (Tank &tank : tanks) {
-    if (tank.active) {
-      // Move tanks according to speed and nudges (see above) also reload
-      tank.tick(background_terrain);
-
-      // Shoot at closest target if reloaded
-      if (tank.rocket_reloaded()) {
-        Tank &target = find_closest_enemy(tank);
-
-        rockets.push_back(
-            Rocket(tank.position,
-                   (target.get_position() - tank.position).normalized() * 3,
-                   rocket_radius, tank.allignment,
-                   ((tank.allignment == RED) ? &rocket_red : &rocket_blue)));
-
-        tank.reload_rocket();
-      }
-    }
+  for (int chunk = 0; chunk < num_chunks; chunk++) {
+    apply_commands(command_buffers[chunk]);
   }
 }
 
-void Game::find_first_and_most_left_tank(int &first_active,
-                                         vec2 &point_on_hull) {
-  first_active = 0;
-  for (Tank &tank : tanks) {
-    if (tank.active) {
-      break;
-    }
-    first_active++;
-  }
-  point_on_hull = tanks.at(first_active).position;
-  // Find left most tank position
-  for (Tank &tank : tanks) {
-    if (tank.active) {
-      if (tank.position.x <= point_on_hull.x) {
-        point_on_hull = tank.position;
-      }
+// Apply the side effects recorded by one task
+void Game::apply_commands(const CommandBuffer &commands) {
+  for (const vec2 &position : commands.explosions) {
+    explosions.push_back(Explosion(&explosion, position));
+  }
+
+  for (const DamageCommand &command : commands.damage_commands) {
+    if (tanks.hit(command.tank, command.damage)) {
+      smokes.push_back(
+          Smoke(smoke, tanks.get_position(command.tank) - vec2(7, 24)));
+      on_tank_destroyed(command.tank);
     }
   }
+
+  for (const Rocket &rocket : commands.rockets) {
+    rockets.spawn(rocket);
+  }
 }
 
-void Game::calculate_convex_hull(int first_active, vec2 &point_on_hull) {
-  while (true) {
-    // Add last found point
-    forcefield_hull.push_back(point_on_hull);
-
-    // Loop through all points replacing the endpoint with the current iteration
-    // every time it lies left of the current segment formed by point_on_hull
-    // and the current endpoint. By the end we have a segment with no points on
-    // the left and thus a point on the convex hull.
-    vec2 endpoint = tanks.at(first_active).position;
-    for (Tank &tank : tanks) {
-      if (tank.active) {
-        if ((endpoint == point_on_hull) ||
-            left_of_line(point_on_hull, endpoint, tank.position)) {
-          endpoint = tank.position;
-        }
-      }
+/*
+ * Moves the tanks, then the tanks whose reload is due this frame shoot at
+ * the closest enemy. Reloads are timers on the reload wheel, so only those
+ * tanks are looked at. A tank destroyed while reloading is not scheduled
+ * again.
+ *
+ * The two team trees are built after the move, at the same time, while the
+ * reload wheel turns. Targeting only reads the trees and the tanks, so the
+ * reloaded tanks are split over the thread pool (in frame 0 that is every
+ * tank). Each chunk records its rockets in its command buffer, and the
+ * buffers are spawned in chunk order. The reloaded tanks are sorted, so the
+ * rockets are spawned in tank order, the same as a serial pass. Moving the
+ * tanks stays serial, it is a small part of the stage and also follows the
+ * routes in the shared route arena.
+ *
+ * Time Complexity: O(N + R * log(R) + R * Q / P), where N is the number of
+ * tanks, R the number of tanks that reloaded, Q a closest enemy query and P
+ * the number of threads.
+ */
+void Game::update_tanks() {
+  // Move tanks according to speed and nudges (see above)
+  tanks.tick(background_terrain);
+
+  // Index both teams once at their new positions, targeting queries the tree
+  // of the enemy team. The reload wheel turns meanwhile.
+  std::future<void> blue_tree =
+      thread_pool.enqueue([this]() { team_trees[BLUE].build(tanks, BLUE); });
+  team_trees[RED].build(tanks, RED);
+
+  reloaded_tanks.clear();
+  reload_wheel.advance(reloaded_tanks);
+  std::sort(reloaded_tanks.begin(), reloaded_tanks.end());
+  blue_tree.wait();
+
+  run_parallel_stage((int)reloaded_tanks.size(), [this](int begin, int end,
+                                                        CommandBuffer &commands) {
+    for (int i = begin; i < end; i++) {
+      const int tank = reloaded_tanks[i];
+      if (!tanks.is_active(tank))
+        continue;
+
+      // Shoot at closest target
+      const vec2 position = tanks.get_position(tank);
+      const int target = find_closest_enemy(tank);
+      const allignments allignment = tanks.allignment[tank];
+
+      commands.spawn_rocket(
+          Rocket(position,
+                 (tanks.get_position(target) - position).normalized() * 3,
+                 rocket_radius, allignment,
+                 ((allignment == RED) ? &rocket_red : &rocket_blue)));
     }
+  });
 
-    // Set the starting point of the next segment to the found endpoint.
-    point_on_hull = endpoint;
-
-    // If we went all the way around we are done.
-    if (endpoint == forcefield_hull.at(0)) {
-      break;
+  for (int tank : reloaded_tanks) {
+    if (tanks.is_active(tank)) {
+      reload_wheel.schedule(tank, rocket_reload_frames);
     }
   }
 }
@@ -339,85 +438,68 @@ void Game::calculate_convex_hull(int first_active, vec2 &point_on_hull) {
  * Thread Pool Implementation:
  * - Distributes rocket processing across multiple CPU cores
  * - Each thread processes a subset of rockets
- * - Uses mutex for thread-safe access to shared resources
+ * - Hits are written to a per task command buffer, no mutex needed
  * - Time Complexity: O(n/m) per thread, where n = number of rockets, m = number
  * of threads
  */
 void Game::update_rockets() {
   // Create a sorted array of active tanks by x-position
-  std::vector<Tank *> sorted_tanks;
+  std::vector<int> sorted_tanks;
   sorted_tanks.reserve(tanks.size());
 
   // Add active tanks to the array
-  for (Tank &tank : tanks) {
-    if (tank.active) {
-      sorted_tanks.push_back(&tank);
+  for (int tank = 0; tank < tanks.size(); tank++) {
+    if (tanks.is_active(tank)) {
+      sorted_tanks.push_back(tank);
     }
   }
 
   // Simple merge sort (in-place)
   merge_sort_tanks(sorted_tanks);
 
-  // Calculate how many rockets per thread
-  const int num_rockets = rockets.size();
-  const int num_threads = std::thread::hardware_concurrency();
-  const int rockets_per_thread =
-      (num_rockets + num_threads - 1) / num_threads; // Ceiling division
-
-  std::vector<std::future<void>> futures;
-
-  // Distribute rockets across threads
-  for (int i = 0; i < num_rockets; i += rockets_per_thread) {
-    int end = std::min(i + rockets_per_thread, num_rockets);
-
-    futures.push_back(thread_pool.enqueue([this, i, end, &sorted_tanks]() {
-      for (int j = i; j < end; j++) {
-        Rocket &rocket = rockets[j];
-        rocket.tick();
-
-        // Find tanks in x-range
-        for (Tank *tank : sorted_tanks) {
-          // Skip friendly tanks
-          if (tank->allignment == rocket.allignment)
-            continue;
-
-          // Quick distance check
-          float dx = rocket.position.x - tank->position.x;
-          if (std::abs(dx) > rocket.collision_radius + tank->collision_radius)
-            continue;
-
-          // Check collision
-          if (rocket.intersects(tank->position, tank->collision_radius)) {
-            std::lock_guard<std::mutex> lock(game_mutex);
-            explosions.push_back(Explosion(&explosion, tank->position));
-
-            if (tank->hit(rocket_hit_value)) {
-              smokes.push_back(Smoke(smoke, tank->position - vec2(7, 24)));
+  // Distribute rockets across threads, hits are recorded and applied after
+  run_parallel_stage(
+      rockets.size(),
+      [this, &sorted_tanks](int begin, int end, CommandBuffer &commands) {
+        for (int j = begin; j < end; j++) {
+          Rocket &rocket = rockets[j];
+          rocket.tick();
+
+          // Find tanks in x-range
+          for (int tank : sorted_tanks) {
+            // Skip friendly tanks
+            if (tanks.allignment[tank] == rocket.allignment)
+              continue;
+
+            // Quick distance check
+            float dx = rocket.position.x - tanks.position_x[tank];
+            if (std::abs(dx) >
+                rocket.collision_radius + tanks.collision_radius[tank])
+              continue;
+
+            // Check collision
+            const vec2 position = tanks.get_position(tank);
+            if (rocket.intersects(position, tanks.collision_radius[tank])) {
+              commands.spawn_explosion(position);
+              commands.apply_damage(tank, rocket_hit_value);
+
+              rocket.active = false;
+              break;
             }
-
-            rocket.active = false;
-            break;
           }
         }
-      }
-    }));
-  }
-
-  // Wait for all tasks to complete
-  for (auto &future : futures) {
-    future.wait();
-  }
+      });
 }
 
 // Simple in-place merge sort
-void Game::merge_sort_tanks(std::vector<Tank *> &tanks) {
-  if (tanks.size() <= 1)
+void Game::merge_sort_tanks(std::vector<int> &sorted_tanks) {
+  if (sorted_tanks.size() <= 1)
     return;
 
   // Split array in half
-  const int mid = tanks.size() / 2;
-  std::vector<Tank *> left(tanks.begin(), tanks.begin() + mid);
-  std::vector<Tank *> right(tanks.begin() + mid, tanks.end());
+  const int mid = sorted_tanks.size() / 2;
+  std::vector<int> left(sorted_tanks.begin(), sorted_tanks.begin() + mid);
+  std::vector<int> right(sorted_tanks.begin() + mid, sorted_tanks.end());
 
   // Recursively sort halves
   merge_sort_tanks(left);
@@ -426,100 +508,304 @@ void Game::merge_sort_tanks(std::vector<Tank *> &tanks) {
   // Merge sorted halves
   int i = 0, j = 0, k = 0;
   while (i < left.size() && j < right.size()) {
-    if (left[i]->position.x <= right[j]->position.x) {
-      tanks[k++] = left[i++];
+    if (tanks.position_x[left[i]] <= tanks.position_x[right[j]]) {
+      sorted_tanks[k++] = left[i++];
     } else {
-      tanks[k++] = right[j++];
+      sorted_tanks[k++] = right[j++];
     }
   }
 
   // Copy remaining elements
   while (i < left.size())
-    tanks[k++] = left[i++];
+    sorted_tanks[k++] = left[i++];
   while (j < right.size())
-    tanks[k++] = right[j++];
+    sorted_tanks[k++] = right[j++];
 }
 
 void Game::disable_rockets_when_collide_forcefield() {
-  for (Rocket &rocket : rockets) {
-    if (rocket.active) {
-      for (size_t i = 0; i < forcefield_hull.size(); i++) {
-        if (circle_segment_intersect(
-                forcefield_hull.at(i),
-                forcefield_hull.at((i + 1) % forcefield_hull.size()),
-                rocket.position, rocket.collision_radius)) {
-          explosions.push_back(Explosion(&explosion, rocket.position));
-          rocket.active = false;
-        }
+  // No tanks left, no forcefield
+  if (forcefield_hull.get_vertices().empty())
+    return;
+
+  // A rocket touches the forcefield unless it is more than its radius inside.
+  // A hull of one tank or of tanks on a line has no inside, there only the
+  // rockets that reach it touch it.
+  forcefield_hull.prepare_containment(rocket_radius);
+
+  run_parallel_stage(rockets.size(), [this](int begin, int end,
+                                            CommandBuffer &commands) {
+    for (int r = begin; r < end; r++) {
+      Rocket &rocket = rockets[r];
+      if (rocket.active && forcefield_hull.touches(rocket.position)) {
+        commands.spawn_explosion(rocket.position);
+        rocket.active = false;
       }
     }
-  }
+  });
 }
 
 /**
  * Thread Pool Implementation for Particle Beam Updates
  *
  * This implementation improves performance by:
- * 1. Distributing particle beam updates across multiple CPU cores
- * 2. Processing beams in parallel
+ * 1. Querying the tank grid with the beam rectangle instead of testing all tanks
+ * 2. Splitting every beam into grid rows, so a few large beams still spread
+ *    over all CPU cores
  * 3. Using a thread pool to manage worker threads
- * 4. Synchronizing access to shared resources with mutexes
+ * 4. Recording hits in per task command buffers instead of locking
  *
  * Time Complexity:
- * - Beam updates: O(n/m) per thread, where n = number of beams, m = number of
- * threads
- * - Overall: O(n) with m threads
+ * - Grid rebuild: O(t + c), where t = number of tanks, c = number of cells
+ * - Beam updates: O(r/m + k/m) per thread, where r = number of beam rows,
+ * k = number of tanks in the beam areas, m = number of threads
  *
- * Space Complexity: O(m) for thread management
+ * Space Complexity: O(b) for the row offsets, where b = number of beams
  *
  * Advantages:
- * - Utilizes all available CPU cores
- * - Scales with hardware capabilities
- * - Efficient thread management
- * - Reduced overall processing time
+ * - Cost per beam depends on its area, not on the number of tanks
+ * - Thousands of beams (or other hazard zones) stay cheap
+ * - Deterministic: the recorded hits are applied in beam and row order
  *
  * Implementation:
- * 1. Initialize thread pool with number of hardware cores
- * 2. Divide beams among threads
- * 3. Process beams in parallel
- * 4. Synchronize access to shared resources
- * 5. Wait for all tasks to complete
+ * 1. Rebuild the tank grid with the current positions
+ * 2. Count the grid rows per beam and prefix sum them into work items
+ * 3. Divide the work items among threads
+ * 4. Visit the cell range of every row and test the tanks in it
+ * 5. Apply the recorded hits in work item order
  */
 void Game::update_particle_beams() {
-  // Calculate how many beams per thread
-  const int num_beams = particle_beams.size();
-  const int num_threads = std::thread::hardware_concurrency();
-  const int beams_per_thread =
-      (num_beams + num_threads - 1) / num_threads; // Ceiling division
+  for (Particle_beam &particle_beam : particle_beams) {
+    particle_beam.tick();
+  }
+
+  // Tanks moved and died since the collision pass, so rebuild the grid
+  tank_grid.build(tanks);
+
+  // A tank is bucketed by its center, so grow the beams by the tank radius.
+  // Every beam gets one work item per grid row it covers.
+  beam_row_start.resize(particle_beams.size() + 1);
+  beam_row_start[0] = 0;
+  for (size_t j = 0; j < particle_beams.size(); j++) {
+    const Rectangle2D &area = particle_beams[j].rectangle;
+    const int rows = tank_grid.cell_y(area.max.y + tank_radius) -
+                     tank_grid.cell_y(area.min.y - tank_radius) + 1;
+    beam_row_start[j + 1] = beam_row_start[j] + rows;
+  }
+
+  // Distribute the beam rows across threads, hits are recorded and applied
+  // after. A tank lives in a single cell, so it is hit once per beam.
+  run_parallel_stage(
+      beam_row_start.back(),
+      [this](int begin, int end, CommandBuffer &commands) {
+        int beam = (int)(std::upper_bound(beam_row_start.begin(),
+                                          beam_row_start.end(), begin) -
+                         beam_row_start.begin()) - 1;
+        for (int item = begin; item < end; item++) {
+          while (item >= beam_row_start[beam + 1]) {
+            beam++;
+          }
 
-  std::vector<std::future<void>> futures;
+          const Rectangle2D &area = particle_beams[beam].rectangle;
+          const int row = tank_grid.cell_y(area.min.y - tank_radius) + item -
+                          beam_row_start[beam];
+          tank_grid.for_each_in_row(
+              row, area.min.x - tank_radius, area.max.x + tank_radius,
+              [&](int tank) {
+                if (area.intersects_circle(tanks.get_position(tank),
+                                           tanks.collision_radius[tank])) {
+                  commands.apply_damage(tank, particle_beam_hit_value);
+                }
+              });
+        }
+      });
+}
 
-  // Distribute beams across threads
-  for (int i = 0; i < num_beams; i += beams_per_thread) {
-    int end = std::min(i + beams_per_thread, num_beams);
-
-    futures.push_back(thread_pool.enqueue([this, i, end]() {
-      for (int j = i; j < end; j++) {
-        Particle_beam &particle_beam = particle_beams[j];
-        particle_beam.tick(tanks);
-
-        // Check for tank hits
-        for (Tank &tank : tanks) {
-          if (tank.active && particle_beam.rectangle.intersects_circle(
-                                 tank.position, tank.collision_radius)) {
-            std::lock_guard<std::mutex> lock(game_mutex);
-            if (tank.hit(particle_beam_hit_value)) {
-              smokes.push_back(Smoke(smoke, tank.position - vec2(7, 24)));
-            }
-          }
+/*
+ * Calculate the route to the destination for each tank. Tanks with the same
+ * target tile share one flow field (a single Dijkstra). On large maps the
+ * hierarchical routes only hold the sector entrances, the tanks refine them
+ * leg by leg while driving.
+ *
+ * The routes only depend on the terrain and on where the tanks spawn and
+ * head to, so they are kept in a cache file: later runs map it and only copy
+ * the routes. A cache of another terrain or spawn layout, or a damaged one,
+ * is ignored and written again.
+ *
+ * Without a cache all routes are computed right away, spread over the
+ * threads. With a route budget (opt-in, it trades the frame 0 spike for
+ * results that depend on timing) the queries go to the route scheduler
+ * instead, front line first, which serves them over the next frames within
+ * its time budget. Until its route arrives a tank drives straight at its
+ * destination.
+ *
+ * Time Complexity (cached): O(N * L), where N is the number of tanks and L
+ * the length of a route.
+ */
+void Game::route_tanks() {
+  const uint64_t key = RouteCache::make_key(background_terrain, tanks,
+                                            (uint32_t)routing_mode);
+  const bool hierarchical = routing_mode == RoutingMode::HIERARCHICAL;
+
+  {
+    RouteCache cache;
+    if (cache.open(route_cache_path, key) && cache.size() == tanks.size()) {
+      for (int tank = 0; tank < tanks.size(); tank++) {
+        uint32_t length;
+        const vec2 *route = cache.get_route(tank, length);
+        if (hierarchical) {
+          tanks.set_waypoints(tank, route, length);
+        } else {
+          tanks.set_route(tank, route, length);
         }
       }
-    }));
+      return;
+    }
   }
 
-  // Wait for all tasks to complete
-  for (auto &future : futures) {
-    future.wait();
+  if (route_scheduler.get_budget() > 0) {
+    for (int tank = 0; tank < tanks.size(); tank++) {
+      route_scheduler.request(
+          tank, RouteScheduler::Priority::SPAWN,
+          (tanks.get_destination(tank) - tanks.get_position(tank)).length());
+    }
+
+    // Flow routes from the spawns are nearly free once the fields exist,
+    // hierarchical ones are not and are left out of the cache
+    if (!hierarchical) {
+      route_cache_key = key;
+      spawn_positions.resize(tanks.size());
+      for (int tank = 0; tank < tanks.size(); tank++) {
+        spawn_positions[tank] = tanks.get_position(tank);
+      }
+      spawn_routes.assign(tanks.size(), {});
+    }
+    return;
+  }
+
+  std::vector<std::vector<vec2>> routes(tanks.size());
+  if (hierarchical) {
+    for (int tank = 0; tank < tanks.size(); tank++) {
+      routes[tank] = background_terrain.get_hierarchical_route(
+          tanks.get_position(tank), tanks.get_target(tank));
+      tanks.set_waypoints(tank, routes[tank]);
+    }
+  } else {
+    background_terrain.get_routes(tanks, thread_pool, routes);
+    for (int tank = 0; tank < tanks.size(); tank++) {
+      tanks.set_route(tank, routes[tank]);
+    }
+  }
+
+  if (!RouteCache::write(route_cache_path, key, routes)) {
+    std::cout << "Could not write route cache: " << route_cache_path
+              << std::endl;
+  }
+}
+
+// Route queries of this frame, as many as fit in the budget. A route starts
+// where the tank is now. The spawn routes for the cache are collected along
+// the way.
+void Game::serve_route_requests() {
+  if (route_scheduler.empty())
+    return;
+
+  const bool hierarchical = routing_mode == RoutingMode::HIERARCHICAL;
+  route_scheduler.run([this, hierarchical](int tank) {
+    const vec2 destination = tanks.get_destination(tank);
+    if (!spawn_positions.empty()) {
+      spawn_routes[tank] = background_terrain.get_flow_route(
+          spawn_positions[tank], destination);
+    }
+    if (!tanks.is_active(tank))
+      return;
+
+    if (hierarchical) {
+      tanks.set_waypoints(tank, background_terrain.get_hierarchical_route(
+                                    tanks.get_position(tank), destination));
+    } else {
+      tanks.set_route(tank, background_terrain.get_flow_route(
+                                tanks.get_position(tank), destination));
+    }
+  });
+
+  // Complete, shutdown writes the cache
+  if (route_scheduler.empty()) {
+    spawn_positions.clear();
+  }
+}
+
+/*
+ * Applies the queued tile edits of the terrain. The flow fields are repaired
+ * instead of rebuilt, and only the tanks standing on a tile whose route to
+ * their destination changed are queued for a new route, ahead of any spawn
+ * routes. The fields are built before the first edit if the routes came
+ * from the route cache, so the change can be compared against them.
+ * Hierarchical routes refine every leg on the current terrain and are left
+ * as they are.
+ *
+ * Time Complexity: O(A + T), where A is the number of tiles whose route
+ * changed and T the number of tanks on them. O(N) over all tanks when an
+ * edit was large enough to rebuild a field.
+ */
+void Game::update_terrain() {
+  const bool hierarchical = routing_mode == RoutingMode::HIERARCHICAL;
+  if (background_terrain.has_pending_edits()) {
+    if (!hierarchical) {
+      background_terrain.cache_flow_fields(tanks, thread_pool);
+    }
+    // The cache key describes the terrain the spawn routes were made on
+    route_cache_key = 0;
+    spawn_positions.clear();
+  }
+
+  background_terrain.update();
+  const std::vector<RouteChange> &changes =
+      background_terrain.get_route_changes();
+  if (changes.empty())
+    return;
+
+  const auto reroute = [this](int tank) {
+    route_scheduler.request(
+        tank, RouteScheduler::Priority::REROUTE,
+        (tanks.get_destination(tank) - tanks.get_position(tank)).length());
+  };
+
+  // Rebuilt fields: every tank heading for the target
+  rebuilt_targets.clear();
+  for (const RouteChange &change : changes) {
+    if (change.rebuilt) {
+      rebuilt_targets.insert(change.target);
+    }
+  }
+  if (!rebuilt_targets.empty()) {
+    for (int tank = 0; tank < tanks.size(); tank++) {
+      if (tanks.is_active(tank) &&
+          rebuilt_targets.count(
+              background_terrain.tile_at(tanks.get_destination(tank)))) {
+        reroute(tank);
+      }
+    }
+  }
+
+  tank_grid.build(tanks);
+  const float tile_size = background_terrain.get_tile_size();
+  for (const RouteChange &change : changes) {
+    for (int tile : change.tiles) {
+      const vec2 corner = background_terrain.tile_position(tile);
+      const int first_row = tank_grid.cell_y(corner.y);
+      const int last_row = tank_grid.cell_y(corner.y + tile_size);
+      for (int row = first_row; row <= last_row; row++) {
+        tank_grid.for_each_in_row(
+            row, corner.x, corner.x + tile_size, [&](int tank) {
+              if (background_terrain.tile_at(tanks.get_position(tank)) ==
+                      tile &&
+                  background_terrain.tile_at(tanks.get_destination(tank)) ==
+                      change.target) {
+                reroute(tank);
+              }
+            });
+      }
+    }
   }
 }
 
@@ -531,13 +817,12 @@ void Game::update_particle_beams() {
 // Targeting etc..
 // -----------------------------------------------------------
 void Game::update(float deltaTime) {
-  // Calculate the route to the destination for each tank using BFS
   // Initializing routes here so it gets counted for performance..
   if (frame_count == 0) {
-    for (Tank &t : tanks) {
-      t.set_route(background_terrain.get_route(t, t.target));
-    }
+    route_tanks();
   }
+  update_terrain();
+  serve_route_requests();
   // Update smoke plumes
   for (Smoke &smoke : smokes) {
     smoke.tick();
@@ -549,16 +834,9 @@ void Game::update(float deltaTime) {
   // Update tanks
   update_tanks();
 
-  // Calculate "force field" around active tanks
-  forcefield_hull.clear();
-
-  // Find first active tank (this loop is a bit disgusting, fix?)
-  int first_active;
-  vec2 point_on_hull{};
-  find_first_and_most_left_tank(first_active, point_on_hull);
-
-  // Calculate convex hull for 'rocket barrier'
-  calculate_convex_hull(first_active, point_on_hull);
+  // Calculate "force field" around active tanks, the convex hull is updated
+  // incrementally from the tanks near last frame's hull
+  forcefield_hull.update(tanks, tanks.get_max_step());
 
   // Update rockets
   update_rockets();
@@ -568,11 +846,8 @@ void Game::update(float deltaTime) {
   // (Disable if outside)
   disable_rockets_when_collide_forcefield();
 
-  // Remove exploded rockets with remove erase idiom
-  rockets.erase(
-      std::remove_if(rockets.begin(), rockets.end(),
-                     [](const Rocket &rocket) { return !rocket.active; }),
-      rockets.end());
+  // Release exploded rockets and rockets that left the battlefield
+  rockets.collect(vec2(0.f, 0.f), background_terrain.get_size());
 
   // Update particle beams
   update_particle_beams();
@@ -601,14 +876,12 @@ void Game::draw() {
   background_terrain.draw(screen);
 
   // Draw sprites
-  for (int i = 0; i < num_tanks_blue + num_tanks_red; i++) {
-    tanks.at(i).draw(screen);
-
-    vec2 tank_pos = tanks.at(i).get_position();
+  for (int tank = 0; tank < tanks.size(); tank++) {
+    tanks.draw(tank, screen);
   }
 
-  for (Rocket &rocket : rockets) {
-    rocket.draw(screen);
+  for (int i = 0; i < rockets.size(); i++) {
+    rockets[i].draw(screen);
   }
 
   for (Smoke &smoke : smokes) {
@@ -624,107 +897,29 @@ void Game::draw() {
   }
 
   // Draw forcefield (mostly for debugging, its kinda ugly..)
-  for (size_t i = 0; i < forcefield_hull.size(); i++) {
-    vec2 line_start = forcefield_hull.at(i);
-    vec2 line_end = forcefield_hull.at((i + 1) % forcefield_hull.size());
+  const std::vector<vec2> &hull = forcefield_hull.get_vertices();
+  for (size_t i = 0; i < hull.size(); i++) {
+    vec2 line_start = hull.at(i);
+    vec2 line_end = hull.at((i + 1) % hull.size());
     line_start.x += HEALTHBAR_OFFSET;
     line_end.x += HEALTHBAR_OFFSET;
     screen->line(line_start, line_end, 0x0000ff);
   }
 
-  // Draw sorted health bars
-  for (int t = 0; t < 2; t++) {
-    const int NUM_TANKS = ((t < 1) ? num_tanks_blue : num_tanks_red);
-
-    const int begin = ((t < 1) ? 0 : num_tanks_blue);
-    std::vector<const Tank *> sorted_tanks;
-    quick_sort_tanks_health(tanks, sorted_tanks, begin, begin + NUM_TANKS);
-    sorted_tanks.erase(
-        std::remove_if(sorted_tanks.begin(), sorted_tanks.end(),
-                       [](const Tank *tank) { return !tank->active; }),
-        sorted_tanks.end());
-
-    draw_health_bars(sorted_tanks, t);
-  }
+  // Draw health bars, least healthy first
+  draw_health_bars(BLUE);
+  draw_health_bars(RED);
 }
 
-// TODO: change this. (changed to quicksort)
-// -----------------------------------------------------------
-// Sort tanks by health value using quicksort (tekst met chatgpt verduidelijkt)
-// Bron voor uitleg: https://www.youtube.com/watch?v=Vtckgz38QHs
-// -----------------------------------------------------------
-// Time Complexity:
-// - Original (insertion sort): O(n²) → very slow with many tanks
-// - New (quicksort): O(n log n) → much faster with many tanks
-//
-// How Quicksort Works:
-// 1. Pick a pivot (middle tank)
-// 2. Put tanks with more health than pivot on left
-// 3. Put tanks with less health than pivot on right
-// 4. Repeat for left and right parts
-//
-// Example with health values:
-// Start:  [50, 90, 30, 70, 60]
-// Pivot = 60
-// Step 1: [90, 70, 60, 30, 50] (60 is in correct spot)
-// Step 2: [90, 70] 60 [30, 50] (sort each side)
-// Final:  [90, 70, 60, 50, 30] (sorted by health)
 // -----------------------------------------------------------
-void Game::quick_sort_tanks_health(const std::vector<Tank> &original,
-                                   std::vector<const Tank *> &sorted_tanks,
-                                   const int begin, const int end) {
-  const int NUM_TANKS = end - begin;
-  sorted_tanks.clear(); // Clear existing tanks
-  sorted_tanks.reserve(NUM_TANKS);
-
-  // First add all tanks we want to sort
-  for (int i = begin; i < end; i++) {
-    sorted_tanks.push_back(&original.at(i));
-  }
-
-  if (!sorted_tanks.empty()) {
-    // Stack for tracking ranges to sort (replaces recursion)
-    vector<pair<int, int>> ranges;
-    ranges.push_back({0, sorted_tanks.size() - 1});
-
-    while (!ranges.empty()) {
-      int low = ranges.back().first;
-      int high = ranges.back().second;
-      ranges.pop_back();
-
-      if (low < high) {
-        // Choose middle element as pivot
-        // If float change to int to avoid errors
-        int mid = low + (high - low) / 2.0f;
-        int mid_int = static_cast<int>(mid);
-        const Tank *pivot = sorted_tanks[mid_int];
-
-        // Move pivot to end
-        std::swap(sorted_tanks[mid_int], sorted_tanks[high]);
-
-        // Partition around pivot
-        int i = low;
-        for (int j = low; j < high; j++) {
-          if (sorted_tanks[j]->compare_health(*pivot) >= 0) {
-            std::swap(sorted_tanks[i], sorted_tanks[j]);
-            i++;
-          }
-        }
-        std::swap(sorted_tanks[i], sorted_tanks[high]);
-
-        // Add ranges for both sides of pivot
-        ranges.push_back({low, i - 1});
-        ranges.push_back({i + 1, high});
-      }
-    }
-  }
-}
-
+// Draw the health bars of the <SCRHEIGHT> least healthy tanks of a team
 // -----------------------------------------------------------
-// Draw the health bars based on the given tanks health values
+// The health histogram of the tank store already has the living tanks
+// counted per health value, so walking it from low to high health visits
+// the tanks in sorted order without sorting or allocating anything.
+// Tanks with the same health share one bar spanning several rows.
 // -----------------------------------------------------------
-void Tmpl8::Game::draw_health_bars(
-    const std::vector<const Tank *> &sorted_tanks, const int team) {
+void Tmpl8::Game::draw_health_bars(const allignments team) {
   int health_bar_start_x = (team < 1) ? 0 : (SCRWIDTH - HEALTHBAR_OFFSET) - 1;
   int health_bar_end_x =
       (team < 1) ? health_bar_width : health_bar_start_x + health_bar_width - 1;
@@ -738,15 +933,20 @@ void Tmpl8::Game::draw_health_bars(
                 health_bar_end_y, REDMASK);
   }
 
-  // Draw the <SCRHEIGHT> least healthy tank health bars
-  int draw_count = std::min(SCRHEIGHT, (int)sorted_tanks.size());
-  for (int i = 0; i < draw_count - 1; i++) {
-    // Health bars are 1 pixel each
-    int health_bar_start_y = i * 1;
-    int health_bar_end_y = health_bar_start_y + 1;
+  const HealthHistogram &histogram = tanks.get_health_histogram();
+  int row = 0;
+  for (int health = 1; health <= histogram.get_max_health(team) &&
+                       row < SCRHEIGHT - 1;
+       health++) {
+    const int count = std::min(histogram.count(team, health), SCRHEIGHT - 1 - row);
+    if (count == 0)
+      continue;
+
+    int health_bar_start_y = row;
+    int health_bar_end_y = row + count;
+    row += count;
 
-    float health_fraction =
-        (1 - ((double)sorted_tanks.at(i)->health / (double)tank_max_health));
+    float health_fraction = (1 - ((double)health / (double)tank_max_health));
 
     if (team == 0) {
       screen->bar(health_bar_start_x +
@@ -8,6 +8,9 @@ class Rocket;
 class Smoke;
 class Particle_beam;
 
+enum class CollisionMode { UNIFORM_GRID, SWEEP_AND_PRUNE };
+enum class RoutingMode { FLOW_FIELDS, HIERARCHICAL };
+
 class Game {
 public:
   // Add a default constructor
@@ -19,44 +22,73 @@ public:
   void update(float deltaTime);
   void draw();
   void tick(float deltaTime);
-  static void quick_sort_tanks_health(const std::vector<Tank> &original,
-                                      std::vector<const Tank *> &sorted_tanks,
-                                      int begin, int end);
-  void draw_health_bars(const std::vector<const Tank *> &sorted_tanks,
-                        const int team);
+  void draw_health_bars(const allignments team);
   void measure_performance();
 
-  Tank &find_closest_enemy(Tank &current_tank);
+  int find_closest_enemy(int current_tank) const;
+
+  // Uniform grid by default, --sweep-and-prune on the command line
+  void set_collision_mode(CollisionMode mode) { collision_mode = mode; }
+  // Flow fields by default, --hierarchical on the command line
+  void set_routing_mode(RoutingMode mode) { routing_mode = mode; }
+  // Flow fields weigh the tiles by cost, --bfs-flow-fields on the command
+  // line builds them with the bit-parallel BFS, counting tiles instead
+  void set_flow_field_algorithm(SearchAlgorithm algorithm) {
+    background_terrain.set_flow_field_algorithm(algorithm);
+  }
+  // Time per frame for route queries, 0 (the default) routes every tank in
+  // frame 0. --route-budget <microseconds> on the command line.
+  void set_route_budget(int microseconds) {
+    route_scheduler.set_budget(microseconds);
+  }
 
 private:
   Surface *screen;
 
   ThreadPool thread_pool;
-  std::mutex game_mutex;
+  std::vector<CommandBuffer> command_buffers; // One per task of a stage
 
-  vector<Tank> tanks;
-  vector<Rocket> rockets;
+  TankStore tanks;
+  SpatialGrid tank_grid;
+  SweepAndPrune sweep_and_prune;
+  CollisionMode collision_mode = CollisionMode::UNIFORM_GRID;
+  RoutingMode routing_mode = RoutingMode::FLOW_FIELDS;
+  RouteScheduler route_scheduler;
+  std::unordered_set<int> rebuilt_targets; // Tiles, see update_terrain
+  // Routes from the spawn positions, collected for the route cache while the
+  // scheduler serves the tanks (complete once spawn_positions is cleared)
+  uint64_t route_cache_key = 0;
+  std::vector<vec2> spawn_positions;
+  std::vector<std::vector<vec2>> spawn_routes;
+  KdTree team_trees[2]; // Indexed by allignment
+  TimingWheel reload_wheel; // Tanks by the frame they reload, see update_tanks
+  std::vector<int> reloaded_tanks;
+  RocketPool rockets;
   vector<Smoke> smokes;
   vector<Explosion> explosions;
   vector<Particle_beam> particle_beams;
+  std::vector<int> beam_row_start; // Prefix sums of the grid rows per beam
 
   Terrain background_terrain;
-  std::vector<vec2> forcefield_hull;
+  ConvexHull forcefield_hull;
 
   Font *frame_count_font;
   long long frame_count = 0;
 
   bool lock_update = false;
 
-  // Checks if a point lies on the left of an arbitrary angled line
-  bool left_of_line(vec2 line_start, vec2 line_end, vec2 point);
   void check_tank_collision();
+  void check_tank_collision_grid();
+  void check_tank_collision_sweep_and_prune();
+  void on_tank_destroyed(int tank);
+  void route_tanks();
+  void serve_route_requests();
+  void update_terrain();
+  template <typename Body> void run_parallel_stage(int count, const Body &body);
+  void apply_commands(const CommandBuffer &commands);
   void update_tanks();
-  void find_first_and_most_left_tank(int &first_active, vec2 &point_on_hull);
-  void calculate_convex_hull(int first_active, vec2 &point_on_hull);
-  void merge_sort_tanks(const vector<Tank *> &tanks);
   void update_rockets();
-  void merge_sort_tanks(std::vector<Tank *> &tanks);
+  void merge_sort_tanks(std::vector<int> &sorted_tanks);
   void disable_rockets_when_collide_forcefield();
   void update_particle_beams();
 };
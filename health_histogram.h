@@ -0,0 +1,40 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// Number of living tanks per team for every health value.
+// Health is a small integer that only goes down, so instead of sorting the
+// tanks every frame the counts are kept up to date on every hit (O(1)) and
+// walked in order when the health bars are drawn.
+class HealthHistogram {
+public:
+  void add(allignments team, int health) {
+    std::vector<int> &team_counts = counts[team];
+    if (health >= (int)team_counts.size()) {
+      team_counts.resize(health + 1, 0);
+    }
+    team_counts[health]++;
+  }
+
+  void remove(allignments team, int health) { counts[team][health]--; }
+
+  void move(allignments team, int from_health, int to_health) {
+    counts[team][from_health]--;
+    counts[team][to_health]++;
+  }
+
+  // Living tanks of the team with exactly this health
+  int count(allignments team, int health) const {
+    return counts[team][health];
+  }
+
+  // Highest health value added so far
+  int get_max_health(allignments team) const {
+    return (int)counts[team].size() - 1;
+  }
+
+private:
+  std::vector<int> counts[2]; // Indexed by allignment
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,118 @@
+#include "precomp.h"
+#include "kd_tree.h"
+
+namespace Tmpl8 {
+
+void KdTree::build(const TankStore &tanks, allignments allignment) {
+  nodes.clear();
+  for (int i = 0; i < tanks.size(); i++) {
+    if (tanks.allignment[i] == allignment && tanks.is_active(i)) {
+      nodes.push_back({tanks.get_position(i), i, true});
+    }
+  }
+
+  live_count.resize(nodes.size());
+  build_range(0, (int)nodes.size(), 0);
+
+  node_of_tank.assign(tanks.size(), -1);
+  for (size_t n = 0; n < nodes.size(); n++) {
+    node_of_tank[nodes[n].tank] = (int)n;
+  }
+}
+
+// Put the median of the range at its middle, smaller coordinates to the left
+void KdTree::build_range(int begin, int end, int depth) {
+  if (begin >= end)
+    return;
+
+  // Every range holds only live tanks right after a build
+  const int mid = (begin + end) / 2;
+  live_count[mid] = end - begin;
+  if (end - begin == 1)
+    return;
+
+  const int axis = depth & 1;
+  std::nth_element(nodes.begin() + begin, nodes.begin() + mid,
+                   nodes.begin() + end, [axis](const Node &a, const Node &b) {
+                     return a.position.cell[axis] < b.position.cell[axis];
+                   });
+
+  build_range(begin, mid, depth + 1);
+  build_range(mid + 1, end, depth + 1);
+}
+
+int KdTree::find_closest(vec2 position) const {
+  float closest_distance = numeric_limits<float>::infinity();
+  int closest_tank = -1;
+  find_closest_range(0, (int)nodes.size(), 0, position, closest_distance,
+                     closest_tank);
+  return closest_tank;
+}
+
+void KdTree::find_closest_range(int begin, int end, int depth, vec2 position,
+                                float &closest_distance,
+                                int &closest_tank) const {
+  if (begin >= end)
+    return;
+
+  const int mid = (begin + end) / 2;
+  if (live_count[mid] == 0)
+    return;
+
+  const Node &node = nodes[mid];
+  if (node.alive) {
+    float sqr_dist = (node.position - position).sqr_length();
+    if (sqr_dist < closest_distance ||
+        (sqr_dist == closest_distance && node.tank < closest_tank)) {
+      closest_distance = sqr_dist;
+      closest_tank = node.tank;
+    }
+  }
+
+  // Visit the side of the split containing the position first, the other side
+  // only if it can still hold a closer (or equally close) tank
+  const int axis = depth & 1;
+  const float delta = position.cell[axis] - node.position.cell[axis];
+  if (delta < 0) {
+    find_closest_range(begin, mid, depth + 1, position, closest_distance,
+                       closest_tank);
+    if (delta * delta <= closest_distance) {
+      find_closest_range(mid + 1, end, depth + 1, position, closest_distance,
+                         closest_tank);
+    }
+  } else {
+    find_closest_range(mid + 1, end, depth + 1, position, closest_distance,
+                       closest_tank);
+    if (delta * delta <= closest_distance) {
+      find_closest_range(begin, mid, depth + 1, position, closest_distance,
+                         closest_tank);
+    }
+  }
+}
+
+void KdTree::remove(int tank_index) {
+  if (tank_index >= (int)node_of_tank.size() || node_of_tank[tank_index] < 0)
+    return;
+
+  const int node = node_of_tank[tank_index];
+  if (!nodes[node].alive)
+    return;
+  nodes[node].alive = false;
+
+  // Walk down from the root to the node, every range on the way lost a tank
+  int begin = 0;
+  int end = (int)nodes.size();
+  while (begin < end) {
+    const int mid = (begin + end) / 2;
+    live_count[mid]--;
+    if (node == mid)
+      break;
+    if (node < mid) {
+      end = mid;
+    } else {
+      begin = mid + 1;
+    }
+  }
+}
+
+} // namespace Tmpl8
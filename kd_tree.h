@@ -0,0 +1,39 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// 2D k-d tree over the active tanks of one allignment, used for targeting.
+// The tree is implicit: the nodes are stored in one array where the root of
+// every range [begin, end) is the median element at its middle, split on x
+// for even depths and on y for odd depths.
+// Destroyed tanks stay in the tree but are skipped, every node keeps the
+// number of live tanks below it so dead subtrees are skipped entirely.
+class KdTree {
+public:
+  // Rebuild over all active tanks with the given allignment, O(n log n)
+  void build(const TankStore &tanks, allignments allignment);
+
+  // Index of the closest live tank, -1 if there is none. Ties are broken on
+  // the lowest tank index, which gives the same result as a linear scan.
+  int find_closest(vec2 position) const;
+
+  // Skip a destroyed tank in future queries, O(log n)
+  void remove(int tank_index);
+
+private:
+  struct Node {
+    vec2 position;
+    int tank;
+    bool alive;
+  };
+
+  void build_range(int begin, int end, int depth);
+  void find_closest_range(int begin, int end, int depth, vec2 position,
+                          float &closest_distance, int &closest_tank) const;
+
+  std::vector<Node> nodes;
+  std::vector<int> live_count; // Live tanks in the range rooted at this node
+  std::vector<int> node_of_tank; // Tank index -> node index, -1 if not in tree
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,133 @@
+#include "precomp.h"
+#include "map_file.h"
+
+namespace Tmpl8 {
+
+static const char map_magic[4] = {'T', 'M', 'A', 'P'};
+
+void MapFile::close() {
+  mapped.close();
+  buffer.clear();
+  data = nullptr;
+  size = 0;
+}
+
+bool MapFile::open(const std::filesystem::path &path) {
+  close();
+  if (!mapped.open(path))
+    return false;
+
+  data = mapped.data();
+  size = mapped.size();
+  if (!validate()) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool MapFile::validate() {
+  if (size < sizeof(MapHeader) ||
+      std::memcmp(header()->magic, map_magic, sizeof(map_magic)) != 0 ||
+      header()->version != current_version)
+    return false;
+
+  const size_t tiles = (size_t)header()->width * header()->height;
+  if (tiles == 0 || size < sizeof(MapHeader) + tiles + (tiles + 7) / 8)
+    return false;
+
+  // Every tile must be a known type, passable exactly when its type is: path
+  // planning trusts the bits, tile costs and speeds trust the types
+  const uint8_t *tile_types = get_tiles();
+  for (size_t tile = 0; tile < tiles; tile++) {
+    if (tile_types[tile] > TileType::WATER ||
+        is_passable((int)tile) != is_passable_tile(TileType(tile_types[tile])))
+      return false;
+  }
+  return true;
+}
+
+bool MapFile::load_text(const std::filesystem::path &path) {
+  close();
+
+  std::ifstream terrain_file(path);
+  if (!terrain_file.is_open())
+    return false;
+
+  std::string terrain_line;
+  std::getline(terrain_file, terrain_line);
+  std::istringstream lineStream(terrain_line);
+
+  int rows = 0;
+  lineStream >> rows;
+
+  std::vector<std::string> lines;
+  size_t columns = 0;
+  for (int row = 0; row < rows && std::getline(terrain_file, terrain_line);
+       row++) {
+    lines.push_back(terrain_line);
+    columns = std::max(columns, terrain_line.size());
+  }
+  if (lines.empty() || columns == 0)
+    return false;
+
+  const size_t tiles = columns * lines.size();
+  buffer.assign(sizeof(MapHeader) + tiles + (tiles + 7) / 8, 0);
+
+  MapHeader map_header;
+  std::memcpy(map_header.magic, map_magic, sizeof(map_magic));
+  map_header.version = current_version;
+  map_header.width = (uint32_t)columns;
+  map_header.height = (uint32_t)lines.size();
+  std::memcpy(buffer.data(), &map_header, sizeof(MapHeader));
+
+  uint8_t *tile_types = buffer.data() + sizeof(MapHeader);
+  uint8_t *passable = tile_types + tiles;
+  for (size_t row = 0; row < lines.size(); row++) {
+    for (size_t collumn = 0; collumn < columns; collumn++) {
+      // Missing characters and unknown tiles are grass
+      TileType tile_type = TileType::GRASS;
+      if (collumn < lines[row].size()) {
+        switch (std::toupper(lines[row][collumn])) {
+        case 'F':
+          tile_type = TileType::FORREST;
+          break;
+        case 'R':
+          tile_type = TileType::ROCKS;
+          break;
+        case 'M':
+          tile_type = TileType::MOUNTAINS;
+          break;
+        case 'W':
+          tile_type = TileType::WATER;
+          break;
+        default:
+          break;
+        }
+      }
+
+      const size_t tile = row * columns + collumn;
+      tile_types[tile] = tile_type;
+      if (is_passable_tile(tile_type)) {
+        passable[tile >> 3] |= uint8_t(1) << (tile & 7);
+      }
+    }
+  }
+
+  data = buffer.data();
+  size = buffer.size();
+  return true;
+}
+
+bool MapFile::convert_text_map(const std::filesystem::path &text_path,
+                               const std::filesystem::path &binary_path) {
+  MapFile map;
+  if (!map.load_text(text_path))
+    return false;
+
+  std::ofstream binary_file(binary_path, std::ios::binary);
+  binary_file.write(reinterpret_cast<const char *>(map.data), map.size);
+  return binary_file.good();
+}
+
+} // namespace Tmpl8
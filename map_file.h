@@ -0,0 +1,55 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// Binary map layout, all of it row major:
+// - MapHeader
+// - width * height bytes, the TileType of every tile
+// - (width * height + 7) / 8 bytes, bit i set when tile i is passable
+struct MapHeader {
+  char magic[4]; // "TMAP"
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+};
+
+// A map, memory mapped from a binary map file so it is used as is, without
+// parsing. Text maps are converted to the same layout in memory.
+class MapFile {
+public:
+  static constexpr uint32_t current_version = 1;
+
+  // Map a binary map file, false if it is missing or damaged
+  bool open(const std::filesystem::path &path);
+
+  // Read a text map: the number of rows on the first line, followed by one
+  // line per row with a character per tile (G, F, R, M or W)
+  bool load_text(const std::filesystem::path &path);
+
+  // Write a text map as binary map file
+  static bool convert_text_map(const std::filesystem::path &text_path,
+                               const std::filesystem::path &binary_path);
+
+  int get_width() const { return (int)header()->width; }
+  int get_height() const { return (int)header()->height; }
+  const uint8_t *get_tiles() const { return data + sizeof(MapHeader); }
+  bool is_passable(int tile) const {
+    const uint8_t *passable = get_tiles() + get_width() * get_height();
+    return (passable[tile >> 3] >> (tile & 7)) & 1;
+  }
+
+private:
+  const MapHeader *header() const {
+    return reinterpret_cast<const MapHeader *>(data);
+  }
+  bool validate();
+  void close();
+
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+
+  MappedFile mapped;
+  std::vector<uint8_t> buffer; // Text maps live here instead
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,74 @@
+#include "precomp.h"
+#include "mapped_file.h"
+
+namespace Tmpl8 {
+
+MappedFile::~MappedFile() { close(); }
+
+void MappedFile::close() {
+  if (mapping != nullptr) {
+#ifdef _WIN32
+    UnmapViewOfFile(mapping);
+#else
+    munmap(mapping, view_size);
+#endif
+  }
+  mapping = nullptr;
+  view = nullptr;
+  view_size = 0;
+}
+
+bool MappedFile::open(const std::filesystem::path &path) {
+  close();
+
+#ifdef _WIN32
+  const HANDLE file =
+      CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  // The view keeps the mapping and the file open, their handles can go
+  const HANDLE file_mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (file_mapping == nullptr)
+    return false;
+  mapping = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(file_mapping);
+  if (mapping == nullptr)
+    return false;
+
+  view_size = (size_t)file_size.QuadPart;
+  view = static_cast<const uint8_t *>(mapping);
+#else
+  const int descriptor = ::open(path.c_str(), O_RDONLY);
+  if (descriptor < 0)
+    return false;
+
+  struct stat file_stat;
+  if (fstat(descriptor, &file_stat) != 0 || file_stat.st_size == 0) {
+    ::close(descriptor);
+    return false;
+  }
+
+  view_size = (size_t)file_stat.st_size;
+  mapping = mmap(nullptr, view_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  ::close(descriptor);
+  if (mapping == MAP_FAILED) {
+    mapping = nullptr;
+    view_size = 0;
+    return false;
+  }
+  view = static_cast<const uint8_t *>(mapping);
+#endif
+  return true;
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,27 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// Read only view of a whole file, memory mapped (MapViewOfFile on Windows,
+// mmap elsewhere).
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // False if the file is missing or empty
+  bool open(const std::filesystem::path &path);
+  void close();
+
+  const uint8_t *data() const { return view; }
+  size_t size() const { return view_size; }
+
+private:
+  const uint8_t *view = nullptr;
+  size_t view_size = 0;
+  void *mapping = nullptr;
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,883 @@
+#include "precomp.h"
+#include "path_grid.h"
+
+namespace Tmpl8 {
+
+static const int offset_x[4] = {1, -1, 0, 0};
+static const int offset_y[4] = {0, 0, 1, -1};
+
+void PathGrid::init(int width, int height) {
+  this->width = width;
+  this->height = height;
+
+  const int tiles = width * height;
+  accessible.assign(tiles, 0);
+  exits.assign(tiles, 0);
+  costs.assign(tiles, 1);
+  jump_distances.clear();
+  jump_points = false;
+  bit_grid.init(width, height);
+}
+
+void PathGrid::enable_jump_points() {
+  if (jump_points)
+    return;
+
+  jump_points = true;
+  jump_distances.assign((size_t)width * height * 4, 0);
+  build_jumps();
+}
+
+void PathGrid::build_jumps() {
+  for (int x = 0; x < width; x++) {
+    build_vertical_jumps(x);
+  }
+  for (int y = 0; y < height; y++) {
+    build_horizontal_jumps(y);
+  }
+}
+
+void PathGrid::set_tile(int x, int y, bool accessible, int cost) {
+  const int tile = tile_index(x, y);
+  this->accessible[tile] = accessible;
+  costs[tile] = cost;
+  bit_grid.set_accessible(tile, accessible);
+}
+
+// Every tile, accessible or not, may step onto an accessible neighbour
+void PathGrid::build_exits() {
+  min_cost = std::numeric_limits<int>::max();
+  max_cost = 1;
+  for (int tile = 0; tile < width * height; tile++) {
+    uint8_t tile_exits = 0;
+    for (int direction = 0; direction < 4; direction++) {
+      const int next = neighbour(tile, direction);
+      if (next >= 0 && accessible[next]) {
+        tile_exits |= uint8_t(1) << direction;
+      }
+    }
+    exits[tile] = tile_exits;
+
+    if (accessible[tile]) {
+      min_cost = std::min(min_cost, costs[tile]);
+      max_cost = std::max(max_cost, costs[tile]);
+    }
+  }
+  // A* and jump point search divide by it, and a free step would break
+  // the bucket queue order
+  min_cost = std::max(1, std::min(min_cost, max_cost));
+
+  if (jump_points) {
+    build_jumps();
+  }
+}
+
+void PathGrid::update_tile(int x, int y, bool accessible, int cost) {
+  set_tile(x, y, accessible, cost);
+  if (accessible) {
+    max_cost = std::max(max_cost, cost);
+    min_cost = std::max(1, std::min(min_cost, cost));
+  }
+
+  // The tile itself and every neighbour that may step onto it
+  const int tile = tile_index(x, y);
+  for (int direction = -1; direction < 4; direction++) {
+    const int changed = (direction < 0) ? tile : neighbour(tile, direction);
+    if (changed < 0)
+      continue;
+
+    uint8_t tile_exits = 0;
+    for (int exit = 0; exit < 4; exit++) {
+      const int next = neighbour(changed, exit);
+      if (next >= 0 && this->accessible[next]) {
+        tile_exits |= uint8_t(1) << exit;
+      }
+    }
+    exits[changed] = tile_exits;
+  }
+  if (!jump_points)
+    return;
+
+  // Forced turns look at the columns beside the tile. A row changes when
+  // the tile is in it or when one of its tiles gained or lost a vertical
+  // jump.
+  std::vector<uint8_t> had_jump((size_t)height * 3, 0);
+  for (int row = 0; row < height; row++) {
+    for (int column = x - 1; column <= x + 1; column++) {
+      if (column >= 0 && column < width)
+        had_jump[row * 3 + column - x + 1] =
+            has_vertical_jump(tile_index(column, row));
+    }
+  }
+  for (int column = std::max(x - 1, 0); column <= std::min(x + 1, width - 1);
+       column++) {
+    build_vertical_jumps(column);
+  }
+  for (int row = 0; row < height; row++) {
+    bool changed = row == y;
+    for (int column = x - 1; column <= x + 1 && !changed; column++) {
+      changed = column >= 0 && column < width &&
+                had_jump[row * 3 + column - x + 1] !=
+                    has_vertical_jump(tile_index(column, row));
+    }
+    if (changed) {
+      build_horizontal_jumps(row);
+    }
+  }
+}
+
+// Tile index of the neighbour in the given direction, -1 outside the grid
+int PathGrid::neighbour(int tile, int direction) const {
+  const int x = tile % width + offset_x[direction];
+  const int y = tile / width + offset_y[direction];
+  if (x < 0 || x >= width || y < 0 || y >= height)
+    return -1;
+  return y * width + x;
+}
+
+// Manhattan distance times the cheapest tile cost, never overestimates.
+// One step changes it by exactly min_cost, so f = cost + heuristic never
+// decreases and never grows more than max_cost + min_cost per step.
+int PathGrid::heuristic(int tile, int target) const {
+  return (std::abs(tile % width - target % width) +
+          std::abs(tile / width - target / width)) *
+         min_cost;
+}
+
+void SearchContext::begin_search(int tiles, int bucket_count) {
+  // First search on this context (or on a grid of another size)
+  if ((int)parent.size() != tiles) {
+    generation = 0;
+    visited_stamp.assign(tiles, 0);
+    closed_stamp.assign(tiles, 0);
+    parent.assign(tiles, -1);
+    cost_so_far.assign(tiles, 0);
+    queue.assign(tiles, 0);
+  }
+  if ((int)buckets.size() != bucket_count) {
+    buckets.resize(bucket_count);
+  }
+
+  // Stamps wrapped around, old marks could match again
+  if (++generation == 0) {
+    std::fill(visited_stamp.begin(), visited_stamp.end(), 0);
+    std::fill(closed_stamp.begin(), closed_stamp.end(), 0);
+    generation = 1;
+  }
+  queue_head = 0;
+  queue_size = 0;
+
+  // A search that found its target early leaves entries behind
+  for (std::vector<int> &bucket : buckets) {
+    bucket.clear();
+  }
+  current_priority = -1;
+  pending = 0;
+}
+
+void SearchContext::queue_push(int tile) {
+  const int capacity = (int)queue.size();
+  queue[(queue_head + queue_size) % capacity] = tile;
+  queue_size++;
+}
+
+int SearchContext::queue_pop() {
+  const int tile = queue[queue_head];
+  queue_head = (queue_head + 1) % (int)queue.size();
+  queue_size--;
+  return tile;
+}
+
+// The first push of a search sets where popping starts, all later pushes
+// are at least the priority of the last popped tile
+void SearchContext::bucket_push(int tile, int priority) {
+  if (current_priority < 0) {
+    current_priority = priority;
+  }
+  buckets[priority % buckets.size()].push_back(tile);
+  pending++;
+}
+
+// Tile with the lowest priority, -1 when empty. Outdated entries are popped
+// as well, the search skips tiles that are already closed.
+int SearchContext::bucket_pop() {
+  if (pending == 0)
+    return -1;
+
+  while (true) {
+    std::vector<int> &bucket = buckets[current_priority % buckets.size()];
+    if (!bucket.empty()) {
+      const int tile = bucket.back();
+      bucket.pop_back();
+      pending--;
+      return tile;
+    }
+    current_priority++;
+  }
+}
+
+bool PathGrid::find_route(SearchContext &context, int start, int target,
+                          SearchAlgorithm algorithm,
+                          std::vector<int> &route) const {
+  route.clear();
+
+  bool found = false;
+  switch (algorithm) {
+  case SearchAlgorithm::BFS:
+    found = breadth_first(context, start, target);
+    break;
+  case SearchAlgorithm::DIJKSTRA:
+    found = best_first(context, start, target, false, whole_area());
+    break;
+  case SearchAlgorithm::A_STAR:
+    found = best_first(context, start, target, true, whole_area());
+    break;
+  case SearchAlgorithm::JUMP_POINT:
+    // Without jump distances the BFS finds a route just as short
+    if (!jump_points) {
+      found = breadth_first(context, start, target);
+      break;
+    }
+    if (!jump_point_search(context, start, target))
+      return false;
+    collect_jump_route(context, target, route);
+    return true;
+  }
+  if (!found)
+    return false;
+
+  collect_route(context, target, route);
+  return true;
+}
+
+bool PathGrid::find_route_in_area(SearchContext &context, int start,
+                                  int target, const PathArea &area,
+                                  std::vector<int> &route) const {
+  route.clear();
+  if (!best_first(context, start, target, true, area))
+    return false;
+
+  collect_route(context, target, route);
+  return true;
+}
+
+void PathGrid::explore_area(SearchContext &context, int start,
+                            const PathArea &area) const {
+  best_first(context, start, -1, false, area);
+}
+
+int PathGrid::get_search_cost(const SearchContext &context, int tile) const {
+  if (context.closed_stamp[tile] != context.generation)
+    return -1;
+  return context.cost_so_far[tile];
+}
+
+void PathGrid::collect_route(const SearchContext &context, int target,
+                             std::vector<int> &route) const {
+  for (int tile = target; tile != -1; tile = context.parent[tile]) {
+    route.push_back(tile);
+  }
+  std::reverse(route.begin(), route.end());
+}
+
+// Every tile enters the queue once, so the ring buffer never overflows
+bool PathGrid::breadth_first(SearchContext &context, int start,
+                             int target) const {
+  context.begin_search(width * height, bucket_count());
+  const uint32_t generation = context.generation;
+  std::vector<uint32_t> &visited_stamp = context.visited_stamp;
+  std::vector<int> &parent = context.parent;
+
+  visited_stamp[start] = generation;
+  parent[start] = -1;
+  if (start == target)
+    return true;
+  context.queue_push(start);
+
+  while (context.queue_size > 0) {
+    const int current = context.queue_pop();
+    const uint8_t current_exits = exits[current];
+
+    for (int direction = 0; direction < 4; direction++) {
+      if (!(current_exits & (1 << direction)))
+        continue;
+
+      const int next = neighbour(current, direction);
+      if (visited_stamp[next] == generation)
+        continue;
+
+      visited_stamp[next] = generation;
+      parent[next] = current;
+      if (next == target)
+        return true;
+      context.queue_push(next);
+    }
+  }
+
+  return false;
+}
+
+// Dijkstra, or A* when a heuristic is used, on Dial's bucket queue.
+// Entering a tile costs its cost. Improved tiles are pushed again instead of
+// being updated, the outdated entries are skipped when popped.
+// Without a target (-1) every tile of the area is visited.
+bool PathGrid::best_first(SearchContext &context, int start, int target,
+                          bool use_heuristic, const PathArea &area) const {
+  context.begin_search(width * height, bucket_count());
+  const uint32_t generation = context.generation;
+  std::vector<uint32_t> &visited_stamp = context.visited_stamp;
+  std::vector<uint32_t> &closed_stamp = context.closed_stamp;
+  std::vector<int> &parent = context.parent;
+  std::vector<int> &cost_so_far = context.cost_so_far;
+
+  if (!area.contains(start % width, start / width))
+    return false;
+
+  visited_stamp[start] = generation;
+  parent[start] = -1;
+  cost_so_far[start] = 0;
+  context.bucket_push(start, use_heuristic ? heuristic(start, target) : 0);
+
+  for (int current = context.bucket_pop(); current != -1;
+       current = context.bucket_pop()) {
+    if (closed_stamp[current] == generation)
+      continue;
+    closed_stamp[current] = generation;
+
+    if (current == target)
+      return true;
+
+    const uint8_t current_exits = exits[current];
+    for (int direction = 0; direction < 4; direction++) {
+      if (!(current_exits & (1 << direction)))
+        continue;
+
+      const int next = neighbour(current, direction);
+      if (closed_stamp[next] == generation ||
+          !area.contains(next % width, next / width))
+        continue;
+
+      const int new_cost = cost_so_far[current] + costs[next];
+      if (visited_stamp[next] == generation && new_cost >= cost_so_far[next])
+        continue;
+
+      visited_stamp[next] = generation;
+      parent[next] = current;
+      cost_so_far[next] = new_cost;
+      context.bucket_push(
+          next, new_cost + (use_heuristic ? heuristic(next, target) : 0));
+    }
+  }
+
+  return false;
+}
+
+// Cheapest routes towards the target: stepping from a tile onto its
+// neighbour costs the cost of that neighbour. Inaccessible tiles (a tank can
+// start on one) get a direction as well, but are never expanded.
+void PathGrid::build_flow_field(SearchContext &context, int target,
+                                FlowField &field,
+                                SearchAlgorithm algorithm) const {
+  if (algorithm == SearchAlgorithm::BFS) {
+    bit_grid.build_flow_field(context, {target}, field);
+    return;
+  }
+
+  field.next.assign(width * height, -1);
+  field.distance.assign(width * height, -1);
+
+  // Routes only lead onto accessible tiles
+  if (!accessible[target])
+    return;
+
+  context.begin_search(width * height, bucket_count());
+  const uint32_t generation = context.generation;
+  std::vector<uint32_t> &closed_stamp = context.closed_stamp;
+
+  field.next[target] = target;
+  field.distance[target] = 0;
+  context.bucket_push(target, 0);
+
+  for (int current = context.bucket_pop(); current != -1;
+       current = context.bucket_pop()) {
+    if (closed_stamp[current] == generation)
+      continue;
+    closed_stamp[current] = generation;
+
+    const int new_distance = field.distance[current] + costs[current];
+    for (int direction = 0; direction < 4; direction++) {
+      const int previous = neighbour(current, direction);
+      if (previous < 0 || closed_stamp[previous] == generation)
+        continue;
+      if (field.distance[previous] != -1 &&
+          new_distance >= field.distance[previous])
+        continue;
+
+      field.next[previous] = current;
+      field.distance[previous] = new_distance;
+      if (accessible[previous]) {
+        context.bucket_push(previous, new_distance);
+      }
+    }
+  }
+}
+
+// LPA* without a heuristic, searching backwards from the target. rhs of a
+// tile is the distance its neighbours offer (min of their distance plus the
+// cost of stepping onto them), the distance in the field is g. Editing a
+// tile changes the rhs of its neighbours only. Tiles where g and rhs differ
+// are queued by the lower of both and settled in that order: a tile that
+// got cheaper takes its rhs, one that got more expensive is reset to
+// unreached and queued again with whatever its neighbours still offer. Both
+// pass the change on to the tiles stepping onto it. Tiles that no edit
+// reaches are never looked at.
+// A settled tile costs several times what it costs Dijkstra, so past an
+// eighth of the map building the field again is faster.
+bool PathGrid::repair_flow_field(SearchContext &context, int target,
+                                 const std::vector<int> &edited,
+                                 FlowField &field, std::vector<int> &affected,
+                                 SearchAlgorithm algorithm) const {
+  const int tiles = width * height;
+  affected.clear();
+
+  // The target itself closed or opened
+  if (!accessible[target] || field.next[target] != target) {
+    build_flow_field(context, target, field, algorithm);
+    return false;
+  }
+
+  if ((int)context.repair_stamp.size() != tiles) {
+    context.repair_generation = 0;
+    context.repair_stamp.assign(tiles, 0);
+    context.rhs.assign(tiles, 0);
+    context.old_next.assign(tiles, -1);
+    context.old_distance.assign(tiles, -1);
+  }
+  if (++context.repair_generation == 0) {
+    std::fill(context.repair_stamp.begin(), context.repair_stamp.end(), 0);
+    context.repair_generation = 1;
+  }
+  const uint32_t generation = context.repair_generation;
+  std::vector<std::pair<int, int>> &heap = context.repair_heap;
+  const auto lowest_first = std::greater<std::pair<int, int>>();
+  context.touched.clear();
+  heap.clear();
+
+  constexpr int unreached = std::numeric_limits<int>::max();
+  const auto g = [&field](int tile) {
+    return field.distance[tile] == -1 ? unreached : field.distance[tile];
+  };
+
+  const auto update = [&](int tile) {
+    if (context.repair_stamp[tile] != generation) {
+      context.repair_stamp[tile] = generation;
+      context.old_next[tile] = field.next[tile];
+      context.old_distance[tile] = field.distance[tile];
+      context.touched.push_back(tile);
+    }
+
+    int rhs = (tile == target) ? 0 : unreached;
+    for (int direction = 0; direction < 4 && tile != target; direction++) {
+      const int next = neighbour(tile, direction);
+      if (next >= 0 && accessible[next] && field.distance[next] != -1) {
+        rhs = std::min(rhs, field.distance[next] + step_cost(next, algorithm));
+      }
+    }
+    context.rhs[tile] = rhs;
+
+    if (rhs != g(tile)) {
+      heap.push_back({std::min(rhs, g(tile)), tile});
+      std::push_heap(heap.begin(), heap.end(), lowest_first);
+    }
+  };
+
+  // Only routes onto accessible tiles, the neighbours of one lead there
+  const auto update_previous = [&](int tile) {
+    for (int direction = 0; direction < 4; direction++) {
+      const int previous = neighbour(tile, direction);
+      if (previous >= 0) {
+        update(previous);
+      }
+    }
+  };
+
+  for (int tile : edited) {
+    update_previous(tile);
+  }
+
+  int settled = 0;
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), lowest_first);
+    const auto [key, tile] = heap.back();
+    heap.pop_back();
+
+    // Settled already, or queued again with another key
+    const int rhs = context.rhs[tile];
+    if (rhs == g(tile) || key != std::min(rhs, g(tile)))
+      continue;
+
+    if (++settled > tiles / 8) {
+      build_flow_field(context, target, field, algorithm);
+      return false;
+    }
+
+    if (rhs < g(tile)) {
+      field.distance[tile] = rhs;
+    } else {
+      field.distance[tile] = -1;
+      update(tile);
+    }
+    if (accessible[tile]) {
+      update_previous(tile);
+    }
+  }
+
+  // Untouched tiles step onto a tile that kept its distance and cost
+  for (int tile : context.touched) {
+    int next = -1;
+    if (tile == target) {
+      next = target;
+    } else if (field.distance[tile] != -1) {
+      for (int direction = 0; direction < 4; direction++) {
+        const int candidate = neighbour(tile, direction);
+        if (candidate >= 0 && accessible[candidate] &&
+            field.distance[candidate] != -1 &&
+            field.distance[candidate] + step_cost(candidate, algorithm) ==
+                field.distance[tile]) {
+          next = candidate;
+          break;
+        }
+      }
+    }
+    field.next[tile] = next;
+  }
+
+  collect_affected(context, edited, field, affected);
+  return true;
+}
+
+// A tile's route changed when its next tile or distance did, or when it
+// leads over an edited tile. So did the route of every tile that used to
+// lead over one of those: walk the field as it was before the repair
+// backwards from them.
+void PathGrid::collect_affected(SearchContext &context,
+                                const std::vector<int> &edited,
+                                const FlowField &field,
+                                std::vector<int> &affected) const {
+  context.begin_search(width * height, bucket_count());
+  const uint32_t generation = context.generation;
+  std::vector<uint32_t> &visited_stamp = context.visited_stamp;
+
+  const auto old_next = [&](int tile) {
+    return context.repair_stamp[tile] == context.repair_generation
+               ? context.old_next[tile]
+               : field.next[tile];
+  };
+  const auto visit = [&](int tile) {
+    if (visited_stamp[tile] != generation) {
+      visited_stamp[tile] = generation;
+      affected.push_back(tile);
+      context.queue_push(tile);
+    }
+  };
+
+  for (int tile : context.touched) {
+    if (field.next[tile] != context.old_next[tile] ||
+        field.distance[tile] != context.old_distance[tile]) {
+      visit(tile);
+    }
+  }
+  for (int tile : edited) {
+    visit(tile);
+  }
+
+  while (context.queue_size > 0) {
+    const int tile = context.queue_pop();
+    for (int direction = 0; direction < 4; direction++) {
+      const int previous = neighbour(tile, direction);
+      if (previous >= 0 && old_next(previous) == tile) {
+        visit(previous);
+      }
+    }
+  }
+}
+
+// Summed cost of the tiles a tank drives over going straight from the top
+// left corner of from to that of to, -1 when one of them is inaccessible.
+// Routes are made of tile corners, and a tank is on the tile its position
+// rounds down to: driving left or up it is on the tile before the corner
+// right away. Each step of the DDA crosses into the next tile in x or y,
+// whichever border the line meets first, up to the last border before the
+// end. Through a corner it brushes the two tiles beside it as well, the
+// costlier one is counted.
+int PathGrid::line_cost(int from, int to) const {
+  const int dx = to % width - from % width;
+  const int dy = to / width - from / width;
+  const int nx = std::abs(dx);
+  const int ny = std::abs(dy);
+  const int step_x = (dx > 0) ? 1 : -1;
+  const int step_y = (dy > 0) ? 1 : -1;
+  int x = from % width - ((dx < 0) ? 1 : 0);
+  int y = from / width - ((dy < 0) ? 1 : 0);
+
+  int cost = 0;
+  for (int ix = 1, iy = 1;;) {
+    const int tile = tile_index(x, y);
+    if (!accessible[tile])
+      return -1;
+    cost += costs[tile];
+
+    // Border ix of nx is met at ix / nx of the way, the last one at the end
+    if (ix >= nx && iy >= ny)
+      break;
+    const int decision = (ix >= nx)   ? 1
+                         : (iy >= ny) ? -1
+                                      : ix * ny - iy * nx;
+    if (decision == 0) {
+      const int side_x = tile_index(x + step_x, y);
+      const int side_y = tile_index(x, y + step_y);
+      if (!accessible[side_x] || !accessible[side_y])
+        return -1;
+      cost += std::max(costs[side_x], costs[side_y]);
+      x += step_x;
+      y += step_y;
+      ix++;
+      iy++;
+    } else if (decision < 0) {
+      x += step_x;
+      ix++;
+    } else {
+      y += step_y;
+      iy++;
+    }
+  }
+  return cost;
+}
+
+// Collinear tiles first: only the corners of the route are candidates. Then
+// string pulling, greedy from the first tile: the line goes on to the next
+// corner as long as that is allowed, the last corner it reached is kept and
+// the next line starts there. Neighbouring corners are joined by a straight
+// stretch of the route, which the line always allows.
+void PathGrid::simplify_route(SearchContext &context,
+                              std::vector<int> &route) const {
+  const int length = (int)route.size();
+  if (length < 3)
+    return;
+
+  std::vector<int> &route_costs = context.route_costs;
+  std::vector<int> &corners = context.corners;
+  route_costs.resize(length);
+  corners.clear();
+
+  // A step right or down drives over the tile it starts on, a step left or
+  // up over the one it ends on, see line_cost
+  route_costs[0] = 0;
+  corners.push_back(0);
+  for (int i = 1; i < length; i++) {
+    route_costs[i] =
+        route_costs[i - 1] + costs[std::min(route[i - 1], route[i])];
+    if (i + 1 < length && route[i] - route[i - 1] != route[i + 1] - route[i]) {
+      corners.push_back(i);
+    }
+  }
+  corners.push_back(length - 1);
+
+  int kept = 1;
+  int anchor = 0;
+  for (int corner = 1; corner < (int)corners.size();) {
+    int reached = corner;
+    for (int next = corner + 1; next < (int)corners.size(); next++) {
+      const int from = corners[anchor];
+      const int to = corners[next];
+      const int cost = line_cost(route[from], route[to]);
+      if (cost < 0 || cost > route_costs[to] - route_costs[from])
+        break;
+      reached = next;
+    }
+
+    route[kept++] = route[corners[reached]];
+    anchor = reached;
+    corner = reached + 1;
+  }
+  route.resize(kept);
+}
+
+// Moving from previous onto next (vertically), a shortest route has to turn
+// here when the tile beside next is open but the one beside previous is not
+bool PathGrid::is_forced(int previous, int next) const {
+  for (int side = 0; side < 2; side++) {
+    const int beside_next = neighbour(next, side);
+    if (beside_next >= 0 && accessible[beside_next] &&
+        !accessible[neighbour(previous, side)])
+      return true;
+  }
+  return false;
+}
+
+// Jump distance of the tile from the one of its neighbour in the same
+// direction, so a row or column is built in one pass from the far end
+int PathGrid::jump_distance_from(int tile, int direction) const {
+  const int next = neighbour(tile, direction);
+  if (next < 0 || !accessible[next])
+    return 0;
+
+  const bool jump_point =
+      (direction >= 2) ? is_forced(tile, next) : has_vertical_jump(next);
+  if (jump_point)
+    return 1;
+
+  const int further = jump_distances[next * 4 + direction];
+  return (further > 0) ? further + 1 : further - 1;
+}
+
+void PathGrid::build_vertical_jumps(int x) {
+  for (int y = height - 1; y >= 0; y--) {
+    const int tile = tile_index(x, y);
+    jump_distances[tile * 4 + 2] = jump_distance_from(tile, 2);
+  }
+  for (int y = 0; y < height; y++) {
+    const int tile = tile_index(x, y);
+    jump_distances[tile * 4 + 3] = jump_distance_from(tile, 3);
+  }
+}
+
+void PathGrid::build_horizontal_jumps(int y) {
+  for (int x = width - 1; x >= 0; x--) {
+    const int tile = tile_index(x, y);
+    jump_distances[tile * 4 + 0] = jump_distance_from(tile, 0);
+  }
+  for (int x = 0; x < width; x++) {
+    const int tile = tile_index(x, y);
+    jump_distances[tile * 4 + 1] = jump_distance_from(tile, 1);
+  }
+}
+
+// Next jump point from the tile in the direction, -1 if there is none.
+// Besides the precomputed ones the target is a jump point, and so is the
+// tile of its column when a horizontal jump passes it and the target can be
+// reached vertically from there.
+int PathGrid::jump(int tile, int direction, int target) const {
+  const int distance = jump_distances[tile * 4 + direction];
+  const int reach = std::abs(distance);
+  const int x = tile % width;
+  const int y = tile / width;
+  const int target_x = target % width;
+  const int target_y = target / width;
+  const int step = offset_x[direction] + offset_y[direction] * width;
+
+  if (direction >= 2) {
+    const int ahead = (target_y - y) * offset_y[direction];
+    if (target_x == x && ahead > 0 && ahead <= reach)
+      return target;
+  } else {
+    const int ahead = (target_x - x) * offset_x[direction];
+    if (ahead > 0 && ahead <= reach) {
+      const int column = tile + ahead * step;
+      if (target_y == y)
+        return target;
+
+      const int vertical = (target_y > y) ? 2 : 3;
+      const int column_distance = jump_distances[column * 4 + vertical];
+      if (column_distance <= 0 && std::abs(target_y - y) <= -column_distance)
+        return column;
+    }
+  }
+
+  return (distance > 0) ? tile + distance * step : -1;
+}
+
+// A* over the jump points, a jump costs the number of tiles it passes.
+// The direction a jump point was reached from decides where it may turn:
+// - the start may go anywhere
+// - after a horizontal jump: straight on, up or down
+// - after a vertical jump: straight on or a forced turn
+bool PathGrid::jump_point_search(SearchContext &context, int start,
+                                 int target) const {
+  context.begin_search(width * height, jump_bucket_count());
+  const uint32_t generation = context.generation;
+  std::vector<uint32_t> &visited_stamp = context.visited_stamp;
+  std::vector<uint32_t> &closed_stamp = context.closed_stamp;
+  std::vector<int> &parent = context.parent;
+  std::vector<int> &cost_so_far = context.cost_so_far;
+
+  parent[start] = -1;
+  if (start == target)
+    return true;
+  if (!accessible[target])
+    return false;
+
+  visited_stamp[start] = generation;
+  cost_so_far[start] = 0;
+  context.bucket_push(start, heuristic(start, target) / min_cost);
+
+  for (int current = context.bucket_pop(); current != -1;
+       current = context.bucket_pop()) {
+    if (closed_stamp[current] == generation)
+      continue;
+    closed_stamp[current] = generation;
+
+    if (current == target)
+      return true;
+
+    uint8_t directions = 0xF;
+    const int from = parent[current];
+    if (from >= 0 && from / width == current / width) {
+      directions = uint8_t(1) << ((current > from) ? 0 : 1);
+      directions |= (1 << 2) | (1 << 3);
+    } else if (from >= 0) {
+      const int vertical = (current > from) ? 2 : 3;
+      const int previous = neighbour(current, vertical ^ 1);
+      directions = uint8_t(1) << vertical;
+      for (int side = 0; side < 2; side++) {
+        const int beside = neighbour(current, side);
+        if (beside >= 0 && accessible[beside] &&
+            !accessible[neighbour(previous, side)]) {
+          directions |= uint8_t(1) << side;
+        }
+      }
+    }
+
+    for (int direction = 0; direction < 4; direction++) {
+      if (!(directions & (1 << direction)))
+        continue;
+
+      const int next = jump(current, direction, target);
+      if (next < 0 || closed_stamp[next] == generation)
+        continue;
+
+      const int new_cost = cost_so_far[current] +
+                           std::abs(next % width - current % width) +
+                           std::abs(next / width - current / width);
+      if (visited_stamp[next] == generation && new_cost >= cost_so_far[next])
+        continue;
+
+      visited_stamp[next] = generation;
+      parent[next] = current;
+      cost_so_far[next] = new_cost;
+      context.bucket_push(next, new_cost + heuristic(next, target) / min_cost);
+    }
+  }
+
+  return false;
+}
+
+// Fill in the straight lines between the jump points
+void PathGrid::collect_jump_route(const SearchContext &context, int target,
+                                  std::vector<int> &route) const {
+  int tile = target;
+  route.push_back(tile);
+  for (int jump_point = context.parent[target]; jump_point != -1;
+       jump_point = context.parent[jump_point]) {
+    const int step = (jump_point / width == tile / width)
+                         ? ((jump_point > tile) ? 1 : -1)
+                         : ((jump_point > tile) ? width : -width);
+    while (tile != jump_point) {
+      tile += step;
+      route.push_back(tile);
+    }
+  }
+  std::reverse(route.begin(), route.end());
+}
+
+} // namespace Tmpl8
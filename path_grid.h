@@ -0,0 +1,230 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// BFS and JUMP_POINT count tiles, Dijkstra and A* weigh them by cost
+enum class SearchAlgorithm { BFS, DIJKSTRA, A_STAR, JUMP_POINT };
+
+// Cheapest routes from every tile towards one target tile.
+// next holds the tile index to step to (the target points to itself),
+// -1 when the target can not be reached. distance is the summed tile cost,
+// or the number of steps for fields built by BFS.
+struct FlowField {
+  std::vector<int> next;
+  std::vector<int> distance;
+};
+
+// Rectangle of tiles a search may visit, bounds included
+struct PathArea {
+  int min_x;
+  int min_y;
+  int max_x;
+  int max_y;
+
+  bool contains(int x, int y) const {
+    return x >= min_x && x <= max_x && y >= min_y && y <= max_y;
+  }
+};
+
+// Scratch memory of route searches. The grid itself is only read while
+// searching, so every thread that searches at the same time needs its own
+// context. Visited marks are stamped with a search generation so they never
+// have to be reset, and the queue and buckets keep their memory between
+// searches: after the first search a context does not allocate.
+class SearchContext {
+public:
+  // Tiles of the last route found, reused by the caller
+  std::vector<int> route_tiles;
+
+private:
+  friend class PathGrid;
+  friend class BitGrid;
+
+  void begin_search(int tiles, int bucket_count);
+  void queue_push(int tile);
+  int queue_pop();
+  void bucket_push(int tile, int priority);
+  int bucket_pop();
+
+  // Search state, only valid where the stamp matches the current generation
+  uint32_t generation = 0;
+  std::vector<uint32_t> visited_stamp;
+  std::vector<uint32_t> closed_stamp;
+  std::vector<int> parent;
+  std::vector<int> cost_so_far;
+
+  // Ring buffer queue for the BFS
+  std::vector<int> queue;
+  int queue_head = 0;
+  int queue_size = 0;
+
+  // Dial's bucket queue for Dijkstra and A*. Priorities are integers and a
+  // pushed priority is never more than the bucket count past the lowest
+  // pending one, so a ring of buckets replaces the heap.
+  std::vector<std::vector<int>> buckets;
+  int current_priority = 0;
+  int pending = 0;
+
+  // Bitsets of the bit-parallel BFS, see BitGrid
+  std::vector<uint64_t> frontier_bits;
+  std::vector<uint64_t> reached_bits;
+  std::vector<uint64_t> next_bits;
+
+  // LPA* repair of a flow field, see PathGrid::repair_flow_field. For every
+  // tile the repair touched (where repair_stamp matches): rhs, the distance
+  // its neighbours offer now, and its next tile and distance before.
+  uint32_t repair_generation = 0;
+  std::vector<uint32_t> repair_stamp;
+  std::vector<int> rhs;
+  std::vector<int> old_next;
+  std::vector<int> old_distance;
+  std::vector<int> touched;
+  std::vector<std::pair<int, int>> repair_heap; // (key, tile), lowest first
+
+  // Route simplification: summed cost up to every route index, and the
+  // indices where the route turns
+  std::vector<int> route_costs;
+  std::vector<int> corners;
+};
+
+// Grid graph for route searches, every array is indexed by tile
+// (y * width + x). The exits of a tile are packed in 4 bits. Once built the
+// grid is read only, searches keep their state in a SearchContext.
+//
+// Jump point search finds routes with as few tiles as BFS, but only expands
+// the tiles where a shortest route may turn. Of all shortest routes it only
+// considers those that move horizontally first: a route moving vertically
+// only turns where the tile beside it was blocked one step earlier (a forced
+// turn), a route moving horizontally may turn at any tile where the vertical
+// scan from it finds a forced turn. The distances to the next such tile (or
+// to the wall) are precomputed per tile and direction, once jump points are
+// enabled. Until then they cost nothing and JUMP_POINT runs the BFS.
+class PathGrid {
+public:
+  // Exit bits, in the order neighbours are expanded
+  static constexpr uint8_t exit_right = 1;
+  static constexpr uint8_t exit_left = 2;
+  static constexpr uint8_t exit_down = 4;
+  static constexpr uint8_t exit_up = 8;
+
+  void init(int width, int height);
+
+  // Set the tiles first, then build the exits. Entering a tile costs its
+  // cost, the cost of inaccessible tiles is ignored.
+  void set_tile(int x, int y, bool accessible, int cost);
+  void build_exits();
+
+  // Change one tile after the exits were built, only the exits of the tile
+  // and its neighbours (and the jump distances crossing them) are updated
+  void update_tile(int x, int y, bool accessible, int cost);
+
+  // Build the jump distances for JUMP_POINT searches, after build_exits.
+  // update_tile keeps them up to date from then on.
+  void enable_jump_points();
+
+  // Route from start to target tile (both included), false if there is none
+  bool find_route(SearchContext &context, int start, int target,
+                  SearchAlgorithm algorithm, std::vector<int> &route) const;
+
+  // A* route that stays inside the area
+  bool find_route_in_area(SearchContext &context, int start, int target,
+                          const PathArea &area, std::vector<int> &route) const;
+
+  // Dijkstra from start to every tile of the area, read the results with
+  // get_search_cost
+  void explore_area(SearchContext &context, int start,
+                    const PathArea &area) const;
+
+  // Cost of the cheapest route to the tile found by the last explore_area,
+  // -1 when it was not reached
+  int get_search_cost(const SearchContext &context, int tile) const;
+
+  // Reverse Dijkstra from the target over the whole grid. With BFS the
+  // field counts steps instead, built by the bit-parallel BFS.
+  void build_flow_field(SearchContext &context, int target, FlowField &field,
+                        SearchAlgorithm algorithm = SearchAlgorithm::DIJKSTRA) const;
+
+  // Repair a field after the edited tiles changed with update_tile, the
+  // algorithm is the one it was built with. Like LPA*, only tiles whose
+  // distance depends on an edited tile are searched again. affected gets
+  // every tile whose route to the target changed. When the change is too
+  // large for that to pay off (or hits the target) the field is built again
+  // instead and false is returned: any route may have changed.
+  bool repair_flow_field(SearchContext &context, int target,
+                         const std::vector<int> &edited, FlowField &field,
+                         std::vector<int> &affected,
+                         SearchAlgorithm algorithm = SearchAlgorithm::DIJKSTRA) const;
+
+  // Fewer tiles for the same way: every tile a straight line from the last
+  // kept tile can skip is dropped. A line only replaces a stretch of the
+  // route when every tile it touches is accessible and its tiles cost no
+  // more than those of the stretch, so the route is as passable and at
+  // least as fast. Only the tiles where the route turns are kept or
+  // skipped to, the first and last tile always stay.
+  void simplify_route(SearchContext &context, std::vector<int> &route) const;
+
+  int get_width() const { return width; }
+  int get_height() const { return height; }
+  int tile_index(int x, int y) const {
+    assert(x >= 0 && x < width && y >= 0 && y < height);
+    return y * width + x;
+  }
+  bool is_accessible(int tile) const { return accessible[tile]; }
+  int get_cost(int tile) const { return costs[tile]; }
+  int get_min_cost() const { return min_cost; }
+  uint8_t get_exits(int tile) const { return exits[tile]; }
+
+private:
+  bool breadth_first(SearchContext &context, int start, int target) const;
+  bool best_first(SearchContext &context, int start, int target,
+                  bool use_heuristic, const PathArea &area) const;
+  void collect_route(const SearchContext &context, int target,
+                     std::vector<int> &route) const;
+  PathArea whole_area() const { return {0, 0, width - 1, height - 1}; }
+  int neighbour(int tile, int direction) const;
+  int heuristic(int tile, int target) const;
+  int bucket_count() const { return max_cost + min_cost + 1; }
+
+  // Cost of stepping onto the tile in a flow field built by the algorithm
+  int step_cost(int tile, SearchAlgorithm algorithm) const {
+    return algorithm == SearchAlgorithm::BFS ? 1 : costs[tile];
+  }
+  int line_cost(int from, int to) const;
+  void collect_affected(SearchContext &context, const std::vector<int> &edited,
+                        const FlowField &field,
+                        std::vector<int> &affected) const;
+
+  bool jump_point_search(SearchContext &context, int start, int target) const;
+  int jump(int tile, int direction, int target) const;
+  void collect_jump_route(const SearchContext &context, int target,
+                          std::vector<int> &route) const;
+  // One jump covers at most a row or column, f grows at most twice that
+  int jump_bucket_count() const { return 2 * (width + height) + 1; }
+
+  void build_jumps();
+  void build_vertical_jumps(int x);
+  void build_horizontal_jumps(int y);
+  int jump_distance_from(int tile, int direction) const;
+  bool is_forced(int previous, int next) const;
+  bool has_vertical_jump(int tile) const {
+    return jump_distances[tile * 4 + 2] > 0 || jump_distances[tile * 4 + 3] > 0;
+  }
+
+  int width = 0;
+  int height = 0;
+  int min_cost = 1;
+  int max_cost = 1;
+
+  std::vector<uint8_t> accessible;
+  std::vector<uint8_t> exits;
+  std::vector<int> costs;
+  BitGrid bit_grid; // Accessible tiles as bits
+
+  // Per tile * 4 + direction: > 0 the distance to the next jump point, <= 0
+  // minus the number of accessible tiles before the wall. Empty until jump
+  // points are enabled.
+  bool jump_points = false;
+  std::vector<int> jump_distances;
+};
+
+} // namespace Tmpl8
@@ -57,6 +57,8 @@
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 // Namespaced C headers:
 #include <cassert>
@@ -64,11 +66,23 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+
+// Memory mapped files (see MappedFile), Windows.h covers them on Windows
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // Header for AVX, and every technology before it.
 // If your CPU does not support this, include the appropriate header instead.
 // See: https://stackoverflow.com/a/11228864/2844473
 /*#include <immintrin.h>*/
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 // clang-format off
 
@@ -83,9 +97,26 @@ using namespace Tmpl8;
 
 #include "thread_pool.h"
 
+#include "route_arena.h"
 #include "tank.h"
+#include "health_histogram.h"
+#include "tank_store.h"
+#include "spatial_grid.h"
+#include "sweep_and_prune.h"
+#include "kd_tree.h"
+#include "convex_hull.h"
+#include "bit_grid.h"
+#include "path_grid.h"
+#include "sector_graph.h"
+#include "mapped_file.h"
 #include "terrain.h"
+#include "map_file.h"
+#include "route_cache.h"
+#include "route_scheduler.h"
+#include "timing_wheel.h"
 #include "rocket.h"
+#include "rocket_pool.h"
+#include "command_buffer.h"
 #include "smoke.h"
 #include "explosion.h"
 #include "particle_beam.h"
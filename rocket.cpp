@@ -4,6 +4,10 @@
 
 namespace Tmpl8
 {
+Rocket::Rocket() : position(0, 0), speed(0, 0), collision_radius(0), allignment(BLUE), current_frame(0), rocket_sprite(nullptr), active(false)
+{
+}
+
 Rocket::Rocket(vec2 position, vec2 direction, float collision_radius, allignments allignment, Sprite* rocket_sprite)
     : position(position), speed(direction), collision_radius(collision_radius), allignment(allignment), current_frame(0), rocket_sprite(rocket_sprite), active(true)
 {
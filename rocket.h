@@ -6,6 +6,7 @@ namespace Tmpl8
 class Rocket
 {
   public:
+    Rocket();
     Rocket(vec2 position, vec2 direction, float collision_radius, allignments allignment, Sprite* rocket_sprite);
     ~Rocket();
 
@@ -0,0 +1,52 @@
+#include "precomp.h"
+#include "rocket_pool.h"
+
+namespace Tmpl8 {
+
+void RocketPool::init(int capacity) {
+  slots.assign(capacity, Rocket());
+  live_slots.clear();
+  live_slots.reserve(capacity);
+
+  // Hand out the lowest slots first
+  free_slots.clear();
+  for (int slot = capacity - 1; slot >= 0; slot--) {
+    free_slots.push_back(slot);
+  }
+}
+
+bool RocketPool::spawn(const Rocket &rocket) {
+  if (free_slots.empty())
+    return false;
+
+  const int slot = free_slots.back();
+  free_slots.pop_back();
+
+  slots[slot] = rocket;
+  live_slots.push_back(slot);
+
+  return true;
+}
+
+// Compact the live list in place (keeps the spawn order), released slots go
+// back on the free list
+void RocketPool::collect(vec2 world_min, vec2 world_max) {
+  size_t kept = 0;
+  for (int slot : live_slots) {
+    Rocket &rocket = slots[slot];
+    const bool inside = rocket.position.x >= world_min.x &&
+                        rocket.position.x <= world_max.x &&
+                        rocket.position.y >= world_min.y &&
+                        rocket.position.y <= world_max.y;
+
+    if (rocket.active && inside) {
+      live_slots[kept++] = slot;
+    } else {
+      rocket.active = false;
+      free_slots.push_back(slot);
+    }
+  }
+  live_slots.resize(kept);
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// Fixed capacity storage for all rockets.
+// Rockets live in preallocated slots that never move, free slots are kept on
+// a free list. The live slots are kept in spawn order, so iterating the pool
+// gives the same order every run.
+class RocketPool {
+public:
+  // Allocate all slots up front, nothing is allocated after this
+  void init(int capacity);
+
+  // False when the pool is full, the rocket is dropped
+  bool spawn(const Rocket &rocket);
+
+  // Release all inactive rockets and the rockets that left the given area
+  void collect(vec2 world_min, vec2 world_max);
+
+  // Live rockets in spawn order
+  int size() const { return (int)live_slots.size(); }
+  Rocket &operator[](int index) { return slots[live_slots[index]]; }
+
+  int get_capacity() const { return (int)slots.size(); }
+
+private:
+  std::vector<Rocket> slots;
+  std::vector<int> free_slots;
+  std::vector<int> live_slots;
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,111 @@
+#include "precomp.h"
+#include "route_arena.h"
+
+namespace Tmpl8 {
+
+// FNV-1a over the bits of the coordinates
+uint64_t RouteArena::hash_route(const vec2 *route, size_t length) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < length; i++) {
+    const vec2 &point = route[i];
+    uint32_t bits[2];
+    std::memcpy(bits, &point.x, sizeof(float));
+    std::memcpy(bits + 1, &point.y, sizeof(float));
+    for (uint32_t word : bits) {
+      hash = (hash ^ word) * 1099511628211ull;
+    }
+  }
+  return hash;
+}
+
+bool RouteArena::equals(uint32_t offset, const vec2 *route,
+                        size_t length) const {
+  for (size_t i = 0; i < length; i++) {
+    if (points[offset + i].x != route[i].x || points[offset + i].y != route[i].y)
+      return false;
+  }
+  return true;
+}
+
+RouteCursor RouteArena::add(const vec2 *route, size_t length) {
+  RouteCursor cursor;
+  if (length == 0)
+    return cursor;
+
+  const uint64_t hash = hash_route(route, length);
+  auto candidates = by_hash.equal_range(hash);
+  for (auto candidate = candidates.first; candidate != candidates.second;
+       ++candidate) {
+    Entry &entry = entries.at(candidate->second);
+    if (entry.length == length && equals(candidate->second, route, length)) {
+      entry.references++;
+      cursor.offset = candidate->second;
+      cursor.length = entry.length;
+      return cursor;
+    }
+  }
+
+  cursor.offset = (uint32_t)points.size();
+  cursor.length = (uint32_t)length;
+  points.insert(points.end(), route, route + length);
+  entries[cursor.offset] = {cursor.length, 1, hash};
+  by_hash.emplace(hash, cursor.offset);
+  return cursor;
+}
+
+void RouteArena::release(const RouteCursor &route) {
+  if (route.length == 0)
+    return;
+
+  auto found = entries.find(route.offset);
+  if (found == entries.end() || --found->second.references > 0)
+    return;
+
+  auto candidates = by_hash.equal_range(found->second.hash);
+  for (auto candidate = candidates.first; candidate != candidates.second;
+       ++candidate) {
+    if (candidate->second == route.offset) {
+      by_hash.erase(candidate);
+      break;
+    }
+  }
+  garbage += found->second.length;
+  entries.erase(found);
+}
+
+// Routes keep their order, so the move is a single forward pass
+void RouteArena::compact() {
+  std::vector<uint32_t> offsets;
+  offsets.reserve(entries.size());
+  for (const auto &entry : entries) {
+    offsets.push_back(entry.first);
+  }
+  std::sort(offsets.begin(), offsets.end());
+
+  relocation.clear();
+  std::unordered_map<uint32_t, Entry> moved_entries;
+  uint32_t end = 0;
+  for (uint32_t offset : offsets) {
+    const Entry &entry = entries[offset];
+    std::copy(points.begin() + offset, points.begin() + offset + entry.length,
+              points.begin() + end);
+    relocation[offset] = end;
+    moved_entries[end] = entry;
+    end += entry.length;
+  }
+  points.resize(end);
+  entries = std::move(moved_entries);
+
+  by_hash.clear();
+  for (const auto &entry : entries) {
+    by_hash.emplace(entry.second.hash, entry.first);
+  }
+  garbage = 0;
+}
+
+uint32_t RouteArena::relocate(uint32_t offset) const {
+  auto found = relocation.find(offset);
+  return (found != relocation.end()) ? found->second : offset;
+}
+
+} // namespace Tmpl8
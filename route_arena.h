@@ -0,0 +1,60 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// A route stored in a RouteArena, followed by advancing the cursor
+struct RouteCursor {
+  uint32_t offset = 0;
+  uint32_t length = 0;
+  uint32_t cursor = 0;
+
+  bool finished() const { return cursor >= length; }
+  uint32_t remaining() const { return length - cursor; }
+};
+
+// All routes in one contiguous buffer of points. Identical routes are stored
+// once and reference counted, so tanks spawned together with the same target
+// share their route. Released routes leave a gap until compact moves the
+// routes still in use to the front.
+class RouteArena {
+public:
+  // Store a route, or add a reference to the identical route already stored
+  RouteCursor add(const vec2 *route, size_t length);
+  RouteCursor add(const std::vector<vec2> &route) {
+    return add(route.data(), route.size());
+  }
+  void release(const RouteCursor &route);
+
+  const vec2 &at(uint32_t index) const { return points[index]; }
+
+  // Most of the buffer is released, worth a compact
+  bool needs_compaction() const {
+    return garbage > min_garbage && garbage * 2 > points.size();
+  }
+
+  // Close the gaps. The offsets of stored routes change, relocate maps an old
+  // offset to the new one until the next compact.
+  void compact();
+  uint32_t relocate(uint32_t offset) const;
+
+private:
+  struct Entry {
+    uint32_t length;
+    uint32_t references;
+    uint64_t hash;
+  };
+
+  static uint64_t hash_route(const vec2 *route, size_t length);
+  bool equals(uint32_t offset, const vec2 *route, size_t length) const;
+
+  static constexpr size_t min_garbage = 4096; // Points
+
+  std::vector<vec2> points;
+  size_t garbage = 0;
+
+  std::unordered_map<uint32_t, Entry> entries;          // By offset
+  std::unordered_multimap<uint64_t, uint32_t> by_hash; // Hash to offset
+  std::unordered_map<uint32_t, uint32_t> relocation;
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,114 @@
+#include "precomp.h"
+#include "route_cache.h"
+
+namespace Tmpl8 {
+
+static_assert(sizeof(vec2) == 2 * sizeof(float), "points are stored as is");
+
+static const char cache_magic[4] = {'R', 'T', 'C', 'H'};
+
+uint64_t RouteCache::hash_bytes(const void *data, size_t size, uint64_t hash) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t RouteCache::make_key(const Terrain &terrain, const TankStore &tanks,
+                              uint32_t routing_mode) {
+  uint64_t key = terrain.get_content_hash();
+  key = hash_bytes(&routing_mode, sizeof(routing_mode), key);
+  const uint32_t algorithm = (uint32_t)terrain.get_flow_field_algorithm();
+  key = hash_bytes(&algorithm, sizeof(algorithm), key);
+  for (int tank = 0; tank < tanks.size(); tank++) {
+    const vec2 spawn[2] = {tanks.get_position(tank), tanks.get_target(tank)};
+    key = hash_bytes(spawn, sizeof(spawn), key);
+  }
+  return key;
+}
+
+bool RouteCache::open(const std::filesystem::path &path, uint64_t key) {
+  if (!file.open(path))
+    return false;
+  if (!validate(key)) {
+    file.close();
+    return false;
+  }
+  return true;
+}
+
+bool RouteCache::validate(uint64_t key) const {
+  if (file.size() < sizeof(Header))
+    return false;
+
+  const Header &cache_header = *header();
+  if (std::memcmp(cache_header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+      cache_header.version != current_version || cache_header.key != key)
+    return false;
+
+  const size_t expected_size = sizeof(Header) +
+                               (size_t)cache_header.num_routes * sizeof(Span) +
+                               (size_t)cache_header.num_points * sizeof(vec2);
+  if (file.size() != expected_size)
+    return false;
+
+  if (hash_bytes(file.data() + sizeof(Header), file.size() - sizeof(Header)) !=
+      cache_header.checksum)
+    return false;
+
+  for (int route = 0; route < size(); route++) {
+    const Span &span = spans()[route];
+    if ((uint64_t)span.offset + span.length > cache_header.num_points)
+      return false;
+  }
+  return true;
+}
+
+// Written next to the cache first, so a run that stops halfway never leaves
+// a cache behind that looks complete
+bool RouteCache::write(const std::filesystem::path &path, uint64_t key,
+                       const std::vector<std::vector<vec2>> &routes) {
+  std::vector<Span> route_spans;
+  route_spans.reserve(routes.size());
+  uint32_t num_points = 0;
+  for (const std::vector<vec2> &route : routes) {
+    route_spans.push_back({num_points, (uint32_t)route.size()});
+    num_points += (uint32_t)route.size();
+  }
+
+  Header cache_header;
+  std::memcpy(cache_header.magic, cache_magic, sizeof(cache_magic));
+  cache_header.version = current_version;
+  cache_header.key = key;
+  cache_header.num_routes = (uint32_t)routes.size();
+  cache_header.num_points = num_points;
+  cache_header.checksum = hash_bytes(route_spans.data(),
+                                     route_spans.size() * sizeof(Span));
+  for (const std::vector<vec2> &route : routes) {
+    cache_header.checksum = hash_bytes(route.data(), route.size() * sizeof(vec2),
+                                       cache_header.checksum);
+  }
+
+  std::filesystem::path temporary_path = path;
+  temporary_path += ".tmp";
+  {
+    std::ofstream cache_file(temporary_path, std::ios::binary);
+    cache_file.write(reinterpret_cast<const char *>(&cache_header),
+                     sizeof(cache_header));
+    cache_file.write(reinterpret_cast<const char *>(route_spans.data()),
+                     route_spans.size() * sizeof(Span));
+    for (const std::vector<vec2> &route : routes) {
+      cache_file.write(reinterpret_cast<const char *>(route.data()),
+                       route.size() * sizeof(vec2));
+    }
+    if (!cache_file.good())
+      return false;
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary_path, path, error);
+  return !error;
+}
+
+} // namespace Tmpl8
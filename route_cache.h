@@ -0,0 +1,65 @@
+#pragma once
+
+namespace Tmpl8 {
+class Terrain;
+
+// Routes of the last run on disk, so the next run with the same terrain and
+// spawns only has to map the file. The file holds a header, one (offset,
+// length) pair per tank and then all route points. The key (a hash of the
+// terrain, the spawns, the routing mode and the flow field algorithm)
+// detects a stale cache, a checksum over everything after the header detects
+// a damaged one.
+class RouteCache {
+public:
+  struct Header {
+    char magic[4]; // "RTCH"
+    uint32_t version;
+    uint64_t key;
+    uint32_t num_routes;
+    uint32_t num_points;
+    uint64_t checksum;
+  };
+
+  struct Span {
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  static constexpr uint32_t current_version = 2; // Simplified routes
+
+  static uint64_t make_key(const Terrain &terrain, const TankStore &tanks,
+                           uint32_t routing_mode);
+
+  // FNV-1a, continues from hash
+  static uint64_t hash_bytes(const void *data, size_t size,
+                             uint64_t hash = 14695981039346656037ull);
+
+  // Map the cache, false if it is missing, stale or damaged
+  bool open(const std::filesystem::path &path, uint64_t key);
+
+  // Write the routes (indexed like the tanks), replacing the old cache
+  static bool write(const std::filesystem::path &path, uint64_t key,
+                    const std::vector<std::vector<vec2>> &routes);
+
+  int size() const { return (int)header()->num_routes; }
+  const vec2 *get_route(int tank, uint32_t &length) const {
+    length = spans()[tank].length;
+    return points() + spans()[tank].offset;
+  }
+
+private:
+  const Header *header() const {
+    return reinterpret_cast<const Header *>(file.data());
+  }
+  const Span *spans() const {
+    return reinterpret_cast<const Span *>(file.data() + sizeof(Header));
+  }
+  const vec2 *points() const {
+    return reinterpret_cast<const vec2 *>(spans() + header()->num_routes);
+  }
+  bool validate(uint64_t key) const;
+
+  MappedFile file;
+};
+
+} // namespace Tmpl8
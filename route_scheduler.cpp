@@ -0,0 +1,33 @@
+#include "precomp.h"
+#include "route_scheduler.h"
+
+namespace Tmpl8 {
+
+void RouteScheduler::request(int tank, Priority priority, float urgency) {
+  if (tank >= (int)queued.size()) {
+    queued.resize(tank + 1, {-1, 0.f, 0});
+  }
+
+  const Request new_request{(int)priority, urgency, tank};
+  if (queued[tank].priority >= 0 && !(queued[tank] > new_request))
+    return;
+
+  // The old entry stays in the heap, pop skips it
+  queued[tank] = new_request;
+  queue.push_back(new_request);
+  std::push_heap(queue.begin(), queue.end(), std::greater<Request>());
+}
+
+int RouteScheduler::pop() {
+  std::pop_heap(queue.begin(), queue.end(), std::greater<Request>());
+  const Request next = queue.back();
+  queue.pop_back();
+
+  Request &current = queued[next.tank];
+  if (current.priority != next.priority || current.urgency != next.urgency)
+    return -1;
+  current.priority = -1;
+  return next.tank;
+}
+
+} // namespace Tmpl8
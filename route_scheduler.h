@@ -0,0 +1,68 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// Route queries spread over frames. Every frame run serves queued requests
+// until the time budget is used up, so routing never stalls a frame for
+// long: the worst frame takes the budget plus one query. Requests are served
+// by priority, and within a priority the tank with the lowest urgency value
+// (its distance to its destination, so the front line) goes first.
+class RouteScheduler {
+public:
+  enum class Priority { REROUTE, SPAWN }; // Served in this order
+
+  // 0 (the default) serves every request in the next run. A budget makes the
+  // frame a route arrives in depend on the timer, so runs are no longer
+  // reproducible frame by frame.
+  void set_budget(int microseconds) { budget = microseconds; }
+  int get_budget() const { return budget; }
+
+  // A tank that is already queued keeps its place unless the new request
+  // is more urgent
+  void request(int tank, Priority priority, float urgency);
+
+  // Calls route(tank) for the requests that fit in the budget, in order.
+  // Returns the number of requests served.
+  template <typename Route> int run(const Route &route) {
+    timer budget_timer;
+    int served = 0;
+    while (!queue.empty()) {
+      if (budget > 0 && served > 0 &&
+          budget_timer.elapsed() * 1000.f >= (float)budget)
+        break;
+
+      const int tank = pop();
+      if (tank < 0)
+        continue;
+      route(tank);
+      served++;
+    }
+    return served;
+  }
+
+  bool empty() const { return queue.empty(); }
+
+private:
+  struct Request {
+    int priority;
+    float urgency;
+    int tank;
+
+    bool operator>(const Request &other) const {
+      if (priority != other.priority)
+        return priority > other.priority;
+      if (urgency != other.urgency)
+        return urgency > other.urgency;
+      return tank > other.tank;
+    }
+  };
+
+  // Most urgent tank, -1 for a request that was replaced by a later one
+  int pop();
+
+  std::vector<Request> queue; // Min heap
+  std::vector<Request> queued; // Per tank, priority -1 when not queued
+  int budget = 0;
+};
+
+} // namespace Tmpl8
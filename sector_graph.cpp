@@ -0,0 +1,384 @@
+#include "precomp.h"
+#include "sector_graph.h"
+
+namespace Tmpl8 {
+
+// Runs of at least this many tiles get two entrances instead of one
+constexpr int long_entrance = 6;
+
+void SectorGraph::build(const PathGrid &grid, SearchContext &context,
+                        int sector_size) {
+  width = grid.get_width();
+  height = grid.get_height();
+  this->sector_size = sector_size;
+  sectors_x = (width + sector_size - 1) / sector_size;
+  sectors_y = (height + sector_size - 1) / sector_size;
+  min_cost = grid.get_min_cost();
+
+  const int num_sectors = sectors_x * sectors_y;
+  nodes.clear();
+  free_nodes.clear();
+  sector_nodes.assign(num_sectors, {});
+  border_nodes.assign(num_sectors * 2, {});
+  sector_dirty.assign(num_sectors, 0);
+  border_dirty.assign(num_sectors * 2, 0);
+  dirty_sectors.clear();
+  dirty_borders.clear();
+
+  for (int border = 0; border < num_sectors * 2; border++) {
+    rebuild_border(grid, border);
+  }
+  for (int sector = 0; sector < num_sectors; sector++) {
+    rebuild_sector_edges(grid, context, sector);
+  }
+  std::fill(sector_dirty.begin(), sector_dirty.end(), 0);
+  dirty_sectors.clear();
+}
+
+int SectorGraph::sector_of(int tile) const {
+  return (tile / width / sector_size) * sectors_x +
+         (tile % width) / sector_size;
+}
+
+PathArea SectorGraph::get_sector_area(int sector) const {
+  const int min_x = (sector % sectors_x) * sector_size;
+  const int min_y = (sector / sectors_x) * sector_size;
+  return {min_x, min_y, std::min(min_x + sector_size, width) - 1,
+          std::min(min_y + sector_size, height) - 1};
+}
+
+// Tiles on a sector edge also change the entrances of that border
+void SectorGraph::invalidate_tile(int x, int y) {
+  const int sector = sector_of(y * width + x);
+  const int local_x = x % sector_size;
+  const int local_y = y % sector_size;
+
+  mark_dirty_sector(sector);
+  if (local_x == sector_size - 1)
+    mark_dirty_border(sector * 2);
+  if (local_x == 0 && x > 0)
+    mark_dirty_border((sector - 1) * 2);
+  if (local_y == sector_size - 1)
+    mark_dirty_border(sector * 2 + 1);
+  if (local_y == 0 && y > 0)
+    mark_dirty_border((sector - sectors_x) * 2 + 1);
+}
+
+void SectorGraph::mark_dirty_sector(int sector) {
+  if (!sector_dirty[sector]) {
+    sector_dirty[sector] = 1;
+    dirty_sectors.push_back(sector);
+  }
+}
+
+void SectorGraph::mark_dirty_border(int border) {
+  if (!border_dirty[border]) {
+    border_dirty[border] = 1;
+    dirty_borders.push_back(border);
+  }
+}
+
+// Borders first: they add and remove nodes, which dirties their sectors
+void SectorGraph::rebuild_dirty(const PathGrid &grid, SearchContext &context) {
+  if (dirty_borders.empty() && dirty_sectors.empty())
+    return;
+
+  min_cost = grid.get_min_cost();
+  for (int border : dirty_borders) {
+    rebuild_border(grid, border);
+    border_dirty[border] = 0;
+  }
+  dirty_borders.clear();
+
+  for (int sector : dirty_sectors) {
+    rebuild_sector_edges(grid, context, sector);
+    sector_dirty[sector] = 0;
+  }
+  dirty_sectors.clear();
+}
+
+int SectorGraph::add_node(int tile) {
+  int node;
+  if (!free_nodes.empty()) {
+    node = free_nodes.back();
+    free_nodes.pop_back();
+  } else {
+    node = (int)nodes.size();
+    nodes.emplace_back();
+  }
+
+  nodes[node].tile = tile;
+  nodes[node].sector = sector_of(tile);
+  nodes[node].alive = true;
+  nodes[node].edges.clear();
+  sector_nodes[nodes[node].sector].push_back(node);
+  return node;
+}
+
+void SectorGraph::add_entrance(const PathGrid &grid, int border, int tile_a,
+                               int tile_b) {
+  const int node_a = add_node(tile_a);
+  const int node_b = add_node(tile_b);
+  nodes[node_a].step = {node_b, grid.get_cost(tile_b)};
+  nodes[node_b].step = {node_a, grid.get_cost(tile_a)};
+  border_nodes[border].push_back(node_a);
+  border_nodes[border].push_back(node_b);
+}
+
+// Tile on the inner side of the border, i tiles along it
+int SectorGraph::border_tile(const PathArea &area, bool bottom, int i) const {
+  return bottom ? area.max_y * width + area.min_x + i
+                : (area.min_y + i) * width + area.max_x;
+}
+
+// Entrances for every run of tiles that are accessible on both sides of the
+// border
+void SectorGraph::rebuild_border(const PathGrid &grid, int border) {
+  const int sector = border / 2;
+  const bool bottom = border & 1;
+  const int sector_x = sector % sectors_x;
+  const int sector_y = sector / sectors_x;
+
+  // Remove the old entrances, the intra sector edges to them go with the
+  // rebuild of both sectors
+  for (int node : border_nodes[border]) {
+    std::vector<int> &in_sector = sector_nodes[nodes[node].sector];
+    in_sector.erase(std::find(in_sector.begin(), in_sector.end(), node));
+    nodes[node].alive = false;
+    free_nodes.push_back(node);
+  }
+  border_nodes[border].clear();
+
+  // Borders at the edge of the map lead nowhere
+  if ((!bottom && sector_x + 1 >= sectors_x) ||
+      (bottom && sector_y + 1 >= sectors_y))
+    return;
+
+  const int other = bottom ? sector + sectors_x : sector + 1;
+  mark_dirty_sector(sector);
+  mark_dirty_sector(other);
+
+  const PathArea area = get_sector_area(sector);
+  const int length = bottom ? area.max_x - area.min_x + 1
+                            : area.max_y - area.min_y + 1;
+
+  const int step = bottom ? width : 1;
+  auto add_entrance_at = [&](int i) {
+    const int tile = border_tile(area, bottom, i);
+    add_entrance(grid, border, tile, tile + step);
+  };
+
+  int run_start = -1;
+  for (int i = 0; i <= length; i++) {
+    const int tile = (i < length) ? border_tile(area, bottom, i) : -1;
+    const bool open = tile >= 0 && grid.is_accessible(tile) &&
+                      grid.is_accessible(tile + step);
+
+    if (open && run_start < 0) {
+      run_start = i;
+    } else if (!open && run_start >= 0) {
+      // Long runs get an entrance near both ends, so routes passing along
+      // the border do not have to detour to the middle
+      const int run_end = i - 1;
+      if (run_end - run_start + 1 >= long_entrance) {
+        add_entrance_at(run_start);
+        add_entrance_at(run_end);
+      } else {
+        add_entrance_at((run_start + run_end) / 2);
+      }
+      run_start = -1;
+    }
+  }
+}
+
+// Cheapest route between every pair of nodes of the sector, one Dijkstra
+// limited to the sector per node
+void SectorGraph::rebuild_sector_edges(const PathGrid &grid,
+                                       SearchContext &context, int sector) {
+  const PathArea area = get_sector_area(sector);
+  const std::vector<int> &in_sector = sector_nodes[sector];
+
+  for (int node : in_sector) {
+    Node &from = nodes[node];
+    from.edges.clear();
+    grid.explore_area(context, from.tile, area);
+
+    for (int other : in_sector) {
+      if (other == node)
+        continue;
+      const int cost = grid.get_search_cost(context, nodes[other].tile);
+      if (cost >= 0) {
+        from.edges.push_back({other, cost});
+      }
+    }
+  }
+}
+
+// A* over the nodes. The start connects to the nodes of its sector and the
+// nodes of the target sector connect to the target, both with the costs of
+// a Dijkstra limited to that sector. The heuristic never overestimates, so
+// the search can stop once no open node can beat the best route found.
+bool SectorGraph::find_route(const PathGrid &grid, SearchContext &context,
+                             int start, int target,
+                             std::vector<int> &waypoints) {
+  waypoints.clear();
+  if (start == target) {
+    waypoints.push_back(start);
+    return true;
+  }
+  if (!grid.is_accessible(target))
+    return false;
+
+  rebuild_dirty(grid, context);
+
+  const int start_sector = sector_of(start);
+  const int target_sector = sector_of(target);
+
+  // Close by: the route probably stays in the sector
+  if (start_sector == target_sector &&
+      grid.find_route_in_area(context, start, target,
+                              get_sector_area(start_sector),
+                              context.route_tiles)) {
+    waypoints.push_back(start);
+    waypoints.push_back(target);
+    return true;
+  }
+
+  if (node_stamp.size() != nodes.size()) {
+    node_stamp.assign(nodes.size(), 0);
+    node_closed.assign(nodes.size(), 0);
+    node_cost.assign(nodes.size(), 0);
+    node_parent.assign(nodes.size(), -1);
+    target_cost.assign(nodes.size(), -1);
+    generation = 0;
+  }
+  if (++generation == 0) {
+    std::fill(node_stamp.begin(), node_stamp.end(), 0);
+    generation = 1;
+  }
+  open.clear();
+
+  // Reversing a route swaps which end tile is paid for
+  const std::vector<int> &target_nodes = sector_nodes[target_sector];
+  grid.explore_area(context, target, get_sector_area(target_sector));
+  for (int node : target_nodes) {
+    const int cost = grid.get_search_cost(context, nodes[node].tile);
+    target_cost[node] = (cost >= 0) ? cost + grid.get_cost(target) -
+                                          grid.get_cost(nodes[node].tile)
+                                    : -1;
+  }
+
+  const int target_x = target % width;
+  const int target_y = target / width;
+  auto heuristic = [this, target_x, target_y](int node) {
+    const int tile = nodes[node].tile;
+    return (std::abs(tile % width - target_x) +
+            std::abs(tile / width - target_y)) *
+           min_cost;
+  };
+  auto relax = [&](int node, int cost, int parent) {
+    if (node_stamp[node] == generation &&
+        (node_closed[node] || cost >= node_cost[node]))
+      return;
+    node_stamp[node] = generation;
+    node_closed[node] = 0;
+    node_cost[node] = cost;
+    node_parent[node] = parent;
+    open.push_back({cost + heuristic(node), node});
+    std::push_heap(open.begin(), open.end(), std::greater<OpenEntry>());
+  };
+
+  grid.explore_area(context, start, get_sector_area(start_sector));
+  for (int node : sector_nodes[start_sector]) {
+    const int cost = grid.get_search_cost(context, nodes[node].tile);
+    if (cost >= 0) {
+      relax(node, cost, -1);
+    }
+  }
+
+  // A tank pushed onto an inaccessible tile may only be able to leave it
+  // into the next sector, where the search above can not go. Start from the
+  // nodes that sector reaches from the tile stepped onto as well. When that
+  // is the target sector the target itself may be reached directly.
+  int direct_cost = std::numeric_limits<int>::max();
+  const int offsets[4] = {1, -1, width, -width}; // Order of the exit bits
+  for (int direction = 0; direction < 4; direction++) {
+    if (!(grid.get_exits(start) & (1 << direction)))
+      continue;
+    const int next = start + offsets[direction];
+    const int next_sector = sector_of(next);
+    if (next_sector == start_sector)
+      continue;
+
+    grid.explore_area(context, next, get_sector_area(next_sector));
+    for (int node : sector_nodes[next_sector]) {
+      const int cost = grid.get_search_cost(context, nodes[node].tile);
+      if (cost >= 0) {
+        relax(node, grid.get_cost(next) + cost, -1);
+      }
+    }
+    const int target_cost_from_next = grid.get_search_cost(context, target);
+    if (next_sector == target_sector && target_cost_from_next >= 0) {
+      direct_cost = std::min(direct_cost,
+                             grid.get_cost(next) + target_cost_from_next);
+    }
+  }
+
+  int best_cost = direct_cost;
+  int best_node = -1;
+  while (!open.empty()) {
+    std::pop_heap(open.begin(), open.end(), std::greater<OpenEntry>());
+    const OpenEntry entry = open.back();
+    open.pop_back();
+
+    if (entry.priority >= best_cost)
+      break;
+    if (node_closed[entry.node])
+      continue;
+    node_closed[entry.node] = 1;
+
+    const int cost = node_cost[entry.node];
+    if (nodes[entry.node].sector == target_sector &&
+        target_cost[entry.node] >= 0 &&
+        cost + target_cost[entry.node] < best_cost) {
+      best_cost = cost + target_cost[entry.node];
+      best_node = entry.node;
+    }
+
+    const Node &node = nodes[entry.node];
+    if (node.step.node >= 0 && nodes[node.step.node].alive) {
+      relax(node.step.node, cost + node.step.cost, entry.node);
+    }
+    for (const Edge &edge : node.edges) {
+      relax(edge.node, cost + edge.cost, entry.node);
+    }
+  }
+
+  for (int node : target_nodes) {
+    target_cost[node] = -1;
+  }
+
+  if (best_node < 0 && best_cost < std::numeric_limits<int>::max()) {
+    waypoints.push_back(start);
+    waypoints.push_back(target);
+    return true;
+  }
+  // Every other tile route crosses the nodes, so there is none
+  if (best_node < 0)
+    return false;
+
+  waypoints.push_back(target);
+  for (int node = best_node; node != -1; node = node_parent[node]) {
+    // Corner tiles can be a node of two borders
+    if (nodes[node].tile != waypoints.back()) {
+      waypoints.push_back(nodes[node].tile);
+    }
+  }
+  if (start != waypoints.back()) {
+    waypoints.push_back(start);
+  }
+  std::reverse(waypoints.begin(), waypoints.end());
+  return true;
+}
+
+} // namespace Tmpl8
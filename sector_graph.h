@@ -0,0 +1,95 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// Abstract graph for hierarchical pathfinding (HPA*) on large maps.
+// The tile grid is cut into square sectors. Where two sectors touch, every
+// run of tiles that is accessible on both sides becomes an entrance: a pair
+// of nodes, one on each side, linked by a single step. Inside a sector every
+// pair of nodes is linked with the cost of the cheapest route between them
+// that stays in the sector.
+//
+// A route is searched on this small graph only, giving a list of waypoints
+// (start, entrances, target). The tile routes between two waypoints stay
+// inside one sector and are cheap to find when they are needed.
+//
+// Changing a tile only marks its sector (and borders) dirty, they are rebuilt
+// before the next search. Searches use scratch memory of the graph, so only
+// one thread at a time may search.
+class SectorGraph {
+public:
+  void build(const PathGrid &grid, SearchContext &context, int sector_size);
+
+  // The tile changed in the grid, rebuild the sectors around it lazily
+  void invalidate_tile(int x, int y);
+
+  // Waypoint tiles from start to target (both included), false if there is
+  // no route
+  bool find_route(const PathGrid &grid, SearchContext &context, int start,
+                  int target, std::vector<int> &waypoints);
+
+  int sector_of(int tile) const;
+  PathArea get_sector_area(int sector) const;
+
+private:
+  struct Edge {
+    int node;
+    int cost;
+  };
+
+  struct Node {
+    int tile;
+    int sector;
+    bool alive;
+    Edge step{-1, 0};        // Across the border
+    std::vector<Edge> edges; // Within the sector
+  };
+
+  // Borders are indexed by sector * 2, + 0 for the right and + 1 for the
+  // bottom border of that sector
+  void rebuild_border(const PathGrid &grid, int border);
+  void rebuild_sector_edges(const PathGrid &grid, SearchContext &context,
+                            int sector);
+  void rebuild_dirty(const PathGrid &grid, SearchContext &context);
+  int border_tile(const PathArea &area, bool bottom, int i) const;
+  int add_node(int tile);
+  void add_entrance(const PathGrid &grid, int border, int tile_a, int tile_b);
+  void mark_dirty_sector(int sector);
+  void mark_dirty_border(int border);
+
+  int width = 0;
+  int height = 0;
+  int sector_size = 1;
+  int sectors_x = 0;
+  int sectors_y = 0;
+  int min_cost = 1;
+
+  std::vector<Node> nodes;
+  std::vector<int> free_nodes;
+  std::vector<std::vector<int>> sector_nodes;
+  std::vector<std::vector<int>> border_nodes;
+
+  std::vector<uint8_t> sector_dirty;
+  std::vector<uint8_t> border_dirty;
+  std::vector<int> dirty_sectors;
+  std::vector<int> dirty_borders;
+
+  // Abstract A* scratch, stamped like SearchContext
+  struct OpenEntry {
+    int priority;
+    int node;
+    bool operator>(const OpenEntry &other) const {
+      return priority > other.priority ||
+             (priority == other.priority && node > other.node);
+    }
+  };
+  uint32_t generation = 0;
+  std::vector<uint32_t> node_stamp;
+  std::vector<uint8_t> node_closed;
+  std::vector<int> node_cost;
+  std::vector<int> node_parent;
+  std::vector<int> target_cost; // Node to target, -1 if not connected
+  std::vector<OpenEntry> open;
+};
+
+} // namespace Tmpl8
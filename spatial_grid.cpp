@@ -0,0 +1,48 @@
+#include "precomp.h"
+#include "spatial_grid.h"
+
+namespace Tmpl8 {
+
+void SpatialGrid::resize(vec2 world_min, vec2 world_max, float cell_size) {
+  this->world_min = world_min;
+  inv_cell_size = 1.f / cell_size;
+  columns = std::max(1, (int)std::ceil((world_max.x - world_min.x) * inv_cell_size));
+  rows = std::max(1, (int)std::ceil((world_max.y - world_min.y) * inv_cell_size));
+
+  cell_start.assign(columns * rows + 1, 0);
+}
+
+// Counting sort of the active tanks into their cells:
+// 1. count tanks per cell
+// 2. prefix sum the counts into start offsets
+// 3. scatter the tank indices in ascending order, so every cell keeps its tanks
+//    sorted by index (keeps the collision order deterministic)
+void SpatialGrid::build(const TankStore &tanks) {
+  std::fill(cell_start.begin(), cell_start.end(), 0);
+  item_cell.resize(tanks.size());
+
+  for (int i = 0; i < tanks.size(); i++) {
+    if (!tanks.is_active(i)) {
+      item_cell[i] = -1;
+      continue;
+    }
+    const int cell = cell_y(tanks.position_y[i]) * columns +
+                     cell_x(tanks.position_x[i]);
+    item_cell[i] = cell;
+    cell_start[cell + 1]++;
+  }
+
+  for (size_t c = 1; c < cell_start.size(); c++) {
+    cell_start[c] += cell_start[c - 1];
+  }
+
+  cell_cursor.assign(cell_start.begin(), cell_start.end() - 1);
+  cell_items.resize(cell_start.back());
+  for (int i = 0; i < tanks.size(); i++) {
+    if (item_cell[i] >= 0) {
+      cell_items[cell_cursor[item_cell[i]]++] = i;
+    }
+  }
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,61 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// Uniform grid over the battlefield, used as broadphase for tank queries.
+// The grid is rebuilt every frame with a counting sort: all tank indices are
+// stored in one flat array ordered by cell, so every cell is a contiguous
+// range and no memory is allocated after the first build.
+class SpatialGrid {
+public:
+  SpatialGrid() = default;
+
+  // (Re)define the covered area, positions outside are clamped to the border
+  void resize(vec2 world_min, vec2 world_max, float cell_size);
+
+  // Bucket all active tanks, O(n + cells)
+  void build(const TankStore &tanks);
+
+  int get_columns() const { return columns; }
+  int get_rows() const { return rows; }
+
+  int cell_x(float x) const {
+    return clamp((int)((x - world_min.x) * inv_cell_size), 0, columns - 1);
+  }
+  int cell_y(float y) const {
+    return clamp((int)((y - world_min.y) * inv_cell_size), 0, rows - 1);
+  }
+
+  // Tank indices stored in the given cell
+  const int *cell_begin(int x, int y) const {
+    return cell_items.data() + cell_start[y * columns + x];
+  }
+  const int *cell_end(int x, int y) const {
+    return cell_items.data() + cell_start[y * columns + x + 1];
+  }
+
+  // Visit the tanks in the cells of row y overlapping [min_x, max_x].
+  // The cells of a row are adjacent in the flat array, so this is one range.
+  template <typename Visit>
+  void for_each_in_row(int y, float min_x, float max_x,
+                       const Visit &visit) const {
+    const int *end = cell_end(cell_x(max_x), y);
+    for (const int *item = cell_begin(cell_x(min_x), y); item < end; item++) {
+      visit(*item);
+    }
+  }
+
+private:
+  vec2 world_min{0.f, 0.f};
+  float inv_cell_size = 1.f;
+  int columns = 0;
+  int rows = 0;
+
+  // Prefix sums of the cell counts, cell c owns [cell_start[c], cell_start[c + 1])
+  std::vector<int> cell_start;
+  std::vector<int> cell_items;
+  std::vector<int> cell_cursor;
+  std::vector<int> item_cell;
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,135 @@
+#include "precomp.h"
+#include "sweep_and_prune.h"
+
+namespace Tmpl8 {
+
+// Full sort and sweep, only needed once
+void SweepAndPrune::initialize(const TankStore &tanks) {
+  endpoints.clear();
+  overlap_pairs.clear();
+  pair_slots.clear();
+  removed.assign(tanks.size(), false);
+
+  for (int i = 0; i < tanks.size(); i++) {
+    if (!tanks.is_active(i)) {
+      removed[i] = true;
+      continue;
+    }
+    const float x = tanks.position_x[i];
+    const float radius = tanks.collision_radius[i];
+    endpoints.push_back({x - radius, i, true});
+    endpoints.push_back({x + radius, i, false});
+  }
+
+  std::sort(endpoints.begin(), endpoints.end(), less);
+
+  // Every tank overlaps with all tanks that are open when its interval starts
+  std::vector<int> open_tanks;
+  for (const Endpoint &endpoint : endpoints) {
+    if (endpoint.is_min) {
+      for (int other : open_tanks) {
+        add_pair(make_pair_key(endpoint.tank, other));
+      }
+      open_tanks.push_back(endpoint.tank);
+    } else {
+      open_tanks.erase(
+          std::find(open_tanks.begin(), open_tanks.end(), endpoint.tank));
+    }
+  }
+
+  initialized = true;
+}
+
+void SweepAndPrune::update(const TankStore &tanks) {
+  if (!initialized) {
+    initialize(tanks);
+    return;
+  }
+
+  if (has_removed_tanks) {
+    drop_removed_tanks();
+  }
+
+  for (Endpoint &endpoint : endpoints) {
+    const float x = tanks.position_x[endpoint.tank];
+    const float radius = tanks.collision_radius[endpoint.tank];
+    endpoint.value = endpoint.is_min ? x - radius : x + radius;
+  }
+
+  // Insertion sort, every swap between a min and a max is an overlap event
+  for (size_t i = 1; i < endpoints.size(); i++) {
+    const Endpoint key = endpoints[i];
+    size_t j = i;
+
+    while (j > 0 && less(key, endpoints[j - 1])) {
+      const Endpoint &passed = endpoints[j - 1];
+
+      if (key.is_min && !passed.is_min) {
+        // Start moved before the end of the other tank: overlap begins
+        add_pair(make_pair_key(key.tank, passed.tank));
+      } else if (!key.is_min && passed.is_min) {
+        // End moved before the start of the other tank: overlap ends
+        remove_pair(make_pair_key(key.tank, passed.tank));
+      }
+
+      endpoints[j] = passed;
+      j--;
+    }
+    endpoints[j] = key;
+  }
+}
+
+void SweepAndPrune::remove(int tank_index) {
+  if (!initialized || removed[tank_index])
+    return;
+
+  removed[tank_index] = true;
+  has_removed_tanks = true;
+}
+
+// Forget the endpoints and pairs of the tanks destroyed since the last
+// update, both lists keep their order
+void SweepAndPrune::drop_removed_tanks() {
+  endpoints.erase(std::remove_if(endpoints.begin(), endpoints.end(),
+                                 [this](const Endpoint &endpoint) {
+                                   return removed[endpoint.tank];
+                                 }),
+                  endpoints.end());
+
+  overlap_pairs.erase(std::remove_if(overlap_pairs.begin(), overlap_pairs.end(),
+                                     [this](uint64_t pair) {
+                                       return removed[pair >> 32] ||
+                                              removed[pair & 0xffffffff];
+                                     }),
+                      overlap_pairs.end());
+  pair_slots.clear();
+  for (int slot = 0; slot < (int)overlap_pairs.size(); slot++) {
+    pair_slots.emplace(overlap_pairs[slot], slot);
+  }
+
+  has_removed_tanks = false;
+}
+
+void SweepAndPrune::add_pair(uint64_t pair) {
+  if (pair_slots.emplace(pair, (int)overlap_pairs.size()).second) {
+    overlap_pairs.push_back(pair);
+  }
+}
+
+// Swap the last pair into the gap
+void SweepAndPrune::remove_pair(uint64_t pair) {
+  const auto it = pair_slots.find(pair);
+  if (it == pair_slots.end())
+    return;
+
+  const int slot = it->second;
+  pair_slots.erase(it);
+  const uint64_t last = overlap_pairs.back();
+  overlap_pairs.pop_back();
+  if (last != pair) {
+    overlap_pairs[slot] = last;
+    pair_slots[last] = slot;
+  }
+}
+
+} // namespace Tmpl8
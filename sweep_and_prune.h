@@ -0,0 +1,60 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// Persistent sweep and prune over the x-axis.
+// The endpoint list is kept between frames. Tanks only move a fraction of a
+// pixel per frame, so the list stays nearly sorted and an insertion sort
+// restores it in close to O(n). Every swap of a min and a max endpoint starts
+// or ends an x-overlap, which keeps the overlap pair list up to date without
+// sweeping the whole list again.
+//
+// The pairs are a dense list in the order their overlap began, a pair that
+// ends is replaced by the last one. That order only depends on the tank
+// movement, so the narrow phase pushes tanks in the same order every run.
+class SweepAndPrune {
+public:
+  // Refresh the endpoints from the tank positions and update the overlap pairs
+  void update(const TankStore &tanks);
+
+  // Mark a destroyed tank in O(1), the next update drops its endpoints and
+  // overlap pairs in a single pass
+  void remove(int tank_index);
+
+  // Pairs of tank indices that overlap on the x-axis, see make_pair_key
+  const std::vector<uint64_t> &get_overlap_pairs() const {
+    return overlap_pairs;
+  }
+
+  static uint64_t make_pair_key(int a, int b) {
+    return (a < b) ? ((uint64_t)a << 32) | (uint32_t)b
+                   : ((uint64_t)b << 32) | (uint32_t)a;
+  }
+
+private:
+  struct Endpoint {
+    float value;
+    int tank;
+    bool is_min;
+  };
+
+  // At equal values an interval end goes first, touching is no overlap
+  static bool less(const Endpoint &a, const Endpoint &b) {
+    return (a.value < b.value) || (a.value == b.value && !a.is_min && b.is_min);
+  }
+
+  void initialize(const TankStore &tanks);
+  void drop_removed_tanks();
+  void add_pair(uint64_t pair);
+  void remove_pair(uint64_t pair);
+
+  bool initialized = false;
+  bool has_removed_tanks = false;
+
+  std::vector<Endpoint> endpoints;
+  std::vector<bool> removed;
+  std::vector<uint64_t> overlap_pairs;
+  std::unordered_map<uint64_t, int> pair_slots; // Index in overlap_pairs
+};
+
+} // namespace Tmpl8
@@ -0,0 +1,229 @@
+#include "precomp.h"
+#include "tank_store.h"
+
+namespace Tmpl8 {
+
+static constexpr float impassable_speed_modifier = 0.5f;
+
+void TankStore::reserve(size_t count) {
+  position_x.reserve(count);
+  position_y.reserve(count);
+  force_x.reserve(count);
+  force_y.reserve(count);
+  target_x.reserve(count);
+  target_y.reserve(count);
+  max_speed.reserve(count);
+  collision_radius.reserve(count);
+  health.reserve(count);
+  allignment.reserve(count);
+  active_mask.reserve((count + 63) / 64);
+  cold.reserve(count);
+}
+
+int TankStore::add(vec2 position, allignments allignment, Sprite *tank_sprite,
+                   Sprite *smoke_sprite, vec2 target, float collision_radius,
+                   int health, float max_speed) {
+  const int tank = size();
+
+  position_x.push_back(position.x);
+  position_y.push_back(position.y);
+  force_x.push_back(0.f);
+  force_y.push_back(0.f);
+  target_x.push_back(target.x);
+  target_y.push_back(target.y);
+  this->max_speed.push_back(max_speed);
+  this->collision_radius.push_back(collision_radius);
+  this->health.push_back(health);
+  this->allignment.push_back(allignment);
+  cold.push_back(Tank(tank_sprite, smoke_sprite));
+  cold.back().destination = target;
+
+  if ((tank & 63) == 0) {
+    active_mask.push_back(0);
+  }
+  active_mask[tank >> 6] |= uint64_t(1) << (tank & 63);
+  health_histogram.add(allignment, health);
+
+  return tank;
+}
+
+// Tanks are processed per 64 bit word of the active mask: fully active words
+// skip the per tank mask test, empty words are skipped entirely.
+// Following routes touches the cold data, so that happens in a second pass
+// and only for tanks that reached their current target.
+void TankStore::tick(Terrain &terrain) {
+  const int num_tanks = size();
+
+  max_step_sqr = 0.f;
+  for (int word = 0; word * 64 < num_tanks; word++) {
+    const uint64_t bits = active_mask[word];
+    if (bits == 0)
+      continue;
+
+    const int begin = word * 64;
+    const int end = std::min(begin + 64, num_tanks);
+    max_step_sqr = std::max(
+        max_step_sqr, move(terrain, begin, end, bits == ~uint64_t(0), bits));
+  }
+
+  if (++animation_frame > 8)
+    animation_frame = 0;
+
+  for (int tank = 0; tank < num_tanks; tank++) {
+    if (std::abs(position_x[tank] - target_x[tank]) < 8.f &&
+        std::abs(position_y[tank] - target_y[tank]) < 8.f && is_active(tank)) {
+      if (cold[tank].route.finished() && !cold[tank].waypoints.finished()) {
+        refine_next_leg(tank, terrain);
+      }
+      follow_route(tank);
+    }
+  }
+
+  if (route_arena.needs_compaction()) {
+    compact_routes();
+  }
+}
+
+// Returns the largest squared step of the moved tanks
+float TankStore::move(const Terrain &terrain, int begin, int end,
+                      bool all_active, uint64_t bits) {
+  float step_sqr = 0.f;
+  for (int tank = begin; tank < end; tank++) {
+    if (!all_active && !((bits >> (tank - begin)) & 1))
+      continue;
+
+    // Direction towards the target, zero when already there
+    const float dx = target_x[tank] - position_x[tank];
+    const float dy = target_y[tank] - position_y[tank];
+    const float sqr_length = dx * dx + dy * dy;
+    const float inv_length = (sqr_length > 0.f) ? 1.f / sqrtf(sqr_length) : 0.f;
+
+    // Tanks only end up on impassable tiles by spawning or being pushed
+    // there, let them crawl off at forest speed instead of getting stuck
+    float speed_modifier = terrain.get_speed_modifier(get_position(tank));
+    if (speed_modifier <= 0.f)
+      speed_modifier = impassable_speed_modifier;
+    const float speed = max_speed[tank] * speed_modifier;
+
+    // Update using accumulated force
+    const float step_x = (dx * inv_length + force_x[tank]) * speed * 0.5f;
+    const float step_y = (dy * inv_length + force_y[tank]) * speed * 0.5f;
+    position_x[tank] += step_x;
+    position_y[tank] += step_y;
+    step_sqr = std::max(step_sqr, step_x * step_x + step_y * step_y);
+
+    force_x[tank] = 0.f;
+    force_y[tank] = 0.f;
+  }
+  return step_sqr;
+}
+
+// Target reached, continue with the next waypoint. The route is released as
+// soon as its last point is taken.
+void TankStore::follow_route(int tank) {
+  RouteCursor &route = cold[tank].route;
+  if (!route.finished()) {
+    const vec2 next = route_arena.at(route.offset + route.cursor++);
+    target_x[tank] = next.x;
+    target_y[tank] = next.y;
+    if (route.finished()) {
+      release_route(route);
+    }
+  }
+}
+
+// Tile route from where the tank is now to its next waypoint
+void TankStore::refine_next_leg(int tank, Terrain &terrain) {
+  RouteCursor &waypoints = cold[tank].waypoints;
+  const vec2 waypoint = route_arena.at(waypoints.offset + waypoints.cursor++);
+  if (waypoints.finished()) {
+    release_route(waypoints);
+  }
+
+  terrain.refine_route(get_position(tank), waypoint, leg_route);
+  cold[tank].route = route_arena.add(leg_route);
+}
+
+void TankStore::set_waypoints(int tank, const vec2 *waypoints,
+                              size_t length) {
+  release_route(cold[tank].waypoints);
+  release_route(cold[tank].route);
+  cold[tank].waypoints = route_arena.add(waypoints, length);
+
+  // Standing on the target makes the next tick refine the first leg
+  target_x[tank] = position_x[tank];
+  target_y[tank] = position_y[tank];
+}
+
+void TankStore::set_route(int tank, const vec2 *route, size_t length) {
+  release_route(cold[tank].route);
+  if (length > 0) {
+    cold[tank].route = route_arena.add(route, length);
+    follow_route(tank);
+  } else {
+    target_x[tank] = position_x[tank];
+    target_y[tank] = position_y[tank];
+  }
+}
+
+void TankStore::release_route(RouteCursor &route) {
+  route_arena.release(route);
+  route = RouteCursor();
+}
+
+void TankStore::compact_routes() {
+  route_arena.compact();
+  for (Tank &tank : cold) {
+    if (tank.route.length > 0)
+      tank.route.offset = route_arena.relocate(tank.route.offset);
+    if (tank.waypoints.length > 0)
+      tank.waypoints.offset = route_arena.relocate(tank.waypoints.offset);
+  }
+}
+
+
+void TankStore::deactivate(int tank) {
+  if (!is_active(tank))
+    return;
+
+  health_histogram.remove(allignment[tank], health[tank]);
+  active_mask[tank >> 6] &= ~(uint64_t(1) << (tank & 63));
+
+  // Freeze the animation of the wreck
+  cold[tank].current_frame = animation_frame;
+}
+
+// Remove health
+bool TankStore::hit(int tank, int hit_value) {
+  if (health[tank] - hit_value <= 0) {
+    // Leave the histogram with the health it was counted under
+    deactivate(tank);
+    health[tank] -= hit_value;
+    return true;
+  }
+
+  if (is_active(tank)) {
+    health_histogram.move(allignment[tank], health[tank],
+                          health[tank] - hit_value);
+  }
+  health[tank] -= hit_value;
+
+  return false;
+}
+
+// Draw the sprite with the facing based on this tanks movement direction
+void TankStore::draw(int tank, Surface *screen) {
+  vec2 position = get_position(tank);
+  vec2 direction = (get_target(tank) - position).normalized();
+  const int frame = is_active(tank) ? animation_frame : cold[tank].current_frame;
+
+  Sprite *tank_sprite = cold[tank].tank_sprite;
+  tank_sprite->set_frame(((abs(direction.x) > abs(direction.y))
+                              ? ((direction.x < 0) ? 3 : 0)
+                              : ((direction.y < 0) ? 9 : 6)) +
+                         (frame / 3));
+  tank_sprite->draw(screen, (int)position.x - 7 + HEALTHBAR_OFFSET,
+                    (int)position.y - 9);
+}
+
+} // namespace Tmpl8
@@ -0,0 +1,100 @@
+#pragma once
+
+namespace Tmpl8 {
+class Terrain;
+
+// All tanks stored as a structure of arrays.
+// Every field that is read or written each frame has its own tightly packed
+// array, so loops over the tanks only pull the fields they use through the
+// cache. Whether a tank is alive is one bit in active_mask. Routes and
+// rendering data are kept apart in the cold Tank block, the route points
+// themselves in a shared RouteArena.
+class TankStore {
+public:
+  void reserve(size_t count);
+
+  // Add a tank and return its index
+  int add(vec2 position, allignments allignment, Sprite *tank_sprite,
+          Sprite *smoke_sprite, vec2 target, float collision_radius,
+          int health, float max_speed);
+
+  int size() const { return (int)position_x.size(); }
+
+  vec2 get_position(int tank) const {
+    return vec2(position_x[tank], position_y[tank]);
+  }
+  vec2 get_target(int tank) const {
+    return vec2(target_x[tank], target_y[tank]);
+  }
+  vec2 get_destination(int tank) const { return cold[tank].destination; }
+  bool is_active(int tank) const {
+    return (active_mask[tank >> 6] >> (tank & 63)) & 1;
+  }
+
+  // Largest distance any tank moved during the last tick
+  float get_max_step() const { return sqrtf(max_step_sqr); }
+
+  // Move all active tanks by their direction and the accumulated force at
+  // the speed of the terrain below them and follow their routes
+  void tick(Terrain &terrain);
+
+  void set_route(int tank, const vec2 *route, size_t length);
+  void set_route(int tank, const std::vector<vec2> &route) {
+    set_route(tank, route.data(), route.size());
+  }
+  // Hierarchical route, the legs are refined on the terrain during tick
+  void set_waypoints(int tank, const vec2 *waypoints, size_t length);
+  void set_waypoints(int tank, const std::vector<vec2> &waypoints) {
+    set_waypoints(tank, waypoints.data(), waypoints.size());
+  }
+
+  void deactivate(int tank);
+  bool hit(int tank, int hit_value);
+
+  // Health of the living tanks per team, kept up to date by hit
+  const HealthHistogram &get_health_histogram() const {
+    return health_histogram;
+  }
+
+  // Add some force in a given direction
+  void push(int tank, vec2 direction, float magnitude) {
+    force_x[tank] += direction.x * magnitude;
+    force_y[tank] += direction.y * magnitude;
+  }
+
+  void draw(int tank, Surface *screen);
+
+  // Hot data
+  std::vector<float> position_x;
+  std::vector<float> position_y;
+  std::vector<float> force_x;
+  std::vector<float> force_y;
+  std::vector<float> target_x;
+  std::vector<float> target_y;
+  std::vector<float> max_speed;
+  std::vector<float> collision_radius;
+  std::vector<int> health;
+  std::vector<allignments> allignment;
+  std::vector<uint64_t> active_mask;
+
+  // Cold data
+  std::vector<Tank> cold;
+
+private:
+  float move(const Terrain &terrain, int begin, int end, bool all_active,
+             uint64_t bits);
+  void follow_route(int tank);
+  void refine_next_leg(int tank, Terrain &terrain);
+  void release_route(RouteCursor &route);
+  void compact_routes();
+
+  // Routes of all tanks, every tank only keeps cursors into it
+  RouteArena route_arena;
+  std::vector<vec2> leg_route; // Scratch for refine_next_leg
+
+  HealthHistogram health_histogram;
+  int animation_frame = 0;
+  float max_step_sqr = 0.f;
+};
+
+} // namespace Tmpl8
@@ -218,6 +218,14 @@ void swap()
 
 int main(int argc, char** argv)
 {
+    // Map converter: --convert-map <text map> <binary map>
+    if (argc == 4 && strcmp(argv[1], "--convert-map") == 0)
+    {
+        const bool converted = Tmpl8::MapFile::convert_text_map(argv[2], argv[3]);
+        printf(converted ? "map converted.\n" : "map conversion failed.\n");
+        return converted ? 0 : 1;
+    }
+
     printf("application started.\n");
     SDL_Init(SDL_INIT_VIDEO);
 
@@ -244,6 +252,22 @@ int main(int argc, char** argv)
     int exitapp = 0;
     game = new Game();
     game->set_target(surface);
+
+    // Alternatives to the defaults, see Game
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--sweep-and-prune") == 0)
+            game->set_collision_mode(CollisionMode::SWEEP_AND_PRUNE);
+        else if (strcmp(argv[i], "--hierarchical") == 0)
+            game->set_routing_mode(RoutingMode::HIERARCHICAL);
+        else if (strcmp(argv[i], "--bfs-flow-fields") == 0)
+            game->set_flow_field_algorithm(SearchAlgorithm::BFS);
+        else if (strcmp(argv[i], "--route-budget") == 0 && i + 1 < argc)
+            game->set_route_budget(atoi(argv[++i]));
+        else
+            printf("unknown option: %s\n", argv[i]);
+    }
+
     timer t;
     t.reset();
     while (!exitapp)
@@ -4,9 +4,6 @@
 namespace fs = std::filesystem;
 namespace Tmpl8 {
 
-using TileMap = vector<vector<TerrainTile>>;
-using TileDistanceMap = unordered_map<TerrainTile *, vec2>;
-
 Terrain::Terrain() {
   // Load in terrain sprites
   grass_img = std::make_unique<Surface>("assets/tile_grass.png");
@@ -21,87 +18,89 @@ Terrain::Terrain() {
   tile_water = std::make_unique<Sprite>(water_img.get(), 1);
   tile_mountains = std::make_unique<Sprite>(mountains_img.get(), 1);
 
-  // Load terrain layout file and fill grid based on tiletypes
-  fs::path terrain_file_path{"assets/terrain.txt"};
-  std::ifstream terrain_file(terrain_file_path);
-
-  if (terrain_file.is_open()) {
-    std::string terrain_line;
-
-    std::getline(terrain_file, terrain_line);
-    std::istringstream lineStream(terrain_line);
-
-    int rows;
-
-    lineStream >> rows;
-
-    for (size_t row = 0; row < rows; row++) {
-      std::getline(terrain_file, terrain_line);
-
-      for (size_t collumn = 0; collumn < terrain_line.size(); collumn++) {
-        switch (std::toupper(terrain_line.at(collumn))) {
-        case 'G':
-          tiles.at(row).at(collumn).tile_type = TileType::GRASS;
-          break;
-        case 'F':
-          tiles.at(row).at(collumn).tile_type = TileType::FORREST;
-          break;
-        case 'R':
-          tiles.at(row).at(collumn).tile_type = TileType::ROCKS;
-          break;
-        case 'M':
-          tiles.at(row).at(collumn).tile_type = TileType::MOUNTAINS;
-          break;
-        case 'W':
-          tiles.at(row).at(collumn).tile_type = TileType::WATER;
-          break;
-        default:
-          tiles.at(row).at(collumn).tile_type = TileType::GRASS;
-          break;
-        }
-      }
-    }
+  // Binary maps are mapped and read without parsing, text maps are converted
+  // first. The tiles are copied out, set_tile changes them.
+  const fs::path map_file_path{"assets/terrain.map"};
+  const fs::path terrain_file_path{"assets/terrain.txt"};
+  MapFile map;
+  const bool loaded = map.open(map_file_path) || map.load_text(terrain_file_path);
+
+  if (loaded) {
+    width = map.get_width();
+    height = map.get_height();
+    tiles.resize((size_t)width * height);
+    std::memcpy(tiles.data(), map.get_tiles(), tiles.size());
   } else {
     std::cout << "Could not open terrain file! Is the path correct? Defaulting "
                  "to grass.."
               << std::endl;
     std::cout << "Path was: " << terrain_file_path << std::endl;
+    width = default_width;
+    height = default_height;
+    tiles.assign((size_t)width * height, TileType::GRASS);
   }
 
   // Instantiate tiles for path planning
-  for (size_t y = 0; y < tiles.size(); y++) {
-    for (size_t x = 0; x < tiles.at(y).size(); x++) {
-      tiles.at(y).at(x).position_x = x;
-      tiles.at(y).at(x).position_y = y;
-
-      if (is_accessible(y, x + 1)) {
-        tiles.at(y).at(x).exits.push_back(&tiles.at(y).at(x + 1));
-      }
-      if (is_accessible(y, x - 1)) {
-        tiles.at(y).at(x).exits.push_back(&tiles.at(y).at(x - 1));
-      }
-      if (is_accessible(y + 1, x)) {
-        tiles.at(y).at(x).exits.push_back(&tiles.at(y + 1).at(x));
-      }
-      if (is_accessible(y - 1, x)) {
-        tiles.at(y).at(x).exits.push_back(&tiles.at(y - 1).at(x));
-      }
+  path_grid.init(width, height);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      const int tile = y * width + x;
+      const bool accessible = loaded ? map.is_passable(tile) : true;
+      path_grid.set_tile(x, y, accessible, tile_cost(tiles[tile]));
     }
   }
+  path_grid.build_exits();
+  sector_graph.build(path_grid, search_context, sector_size);
 }
 
 void Terrain::update() {
-  // Pretend there is animation code here.. next year :)
+  route_changes.clear();
+  if (pending_edits.empty())
+    return;
+
+  edited_tiles.clear();
+  for (const TileEdit &edit : pending_edits) {
+    if (tiles[edit.tile] == edit.tile_type)
+      continue;
+
+    const int x = edit.tile % width;
+    const int y = edit.tile / width;
+    tiles[edit.tile] = edit.tile_type;
+    path_grid.update_tile(x, y, is_accessible(y, x), tile_cost(edit.tile_type));
+    sector_graph.invalidate_tile(x, y);
+    edited_tiles.push_back(edit.tile);
+  }
+  pending_edits.clear();
+  if (edited_tiles.empty())
+    return;
+
+  // A flow field covers the whole map, any of them may lead over the tiles
+  std::lock_guard<std::mutex> lock(flow_field_mutex);
+  for (auto &[target, field] : flow_fields) {
+    const bool repaired = path_grid.repair_flow_field(
+        search_context, target, edited_tiles, field, affected_tiles,
+        flow_field_algorithm);
+    if (!repaired || !affected_tiles.empty()) {
+      route_changes.push_back({target, !repaired, affected_tiles});
+    }
+  }
+}
+
+void Terrain::set_tile(size_t x, size_t y, TileType tile_type) {
+  if (x >= (size_t)width || y >= (size_t)height)
+    throw std::out_of_range("Terrain::set_tile");
+
+  pending_edits.push_back({(int)(y * width + x), tile_type});
 }
 
 void Terrain::draw(Surface *target) const {
 
-  for (size_t y = 0; y < tiles.size(); y++) {
-    for (size_t x = 0; x < tiles.at(y).size(); x++) {
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
       int posX = (x * sprite_size) + HEALTHBAR_OFFSET;
       int posY = y * sprite_size;
 
-      switch (tiles.at(y).at(x).tile_type) {
+      switch (tiles[y * width + x]) {
       case TileType::GRASS:
         tile_grass->draw(target, posX, posY);
         break;
@@ -135,242 +134,260 @@ void Terrain::draw(Surface *target) const {
 // 5 Release runs elk.
 */
 
-// Resultaat: sneller dan BFS (speedup 1.1 vs 1.0 origineel)
-// A* algorithm to find shortest route to the destination
-// BIG O: O(n^2)
-// vector<vec2> Terrain::get_route(const Tank &tank, const vec2 &target) {
-//     // Convert positions to tile coordinates
-//     const size_t start_x = tank.position.x / sprite_size;
-//     const size_t start_y = tank.position.y / sprite_size;
-//     const size_t target_x = target.x / sprite_size;
-//     const size_t target_y = target.y / sprite_size;
-//
-//     TerrainTile *start_tile = &tiles.at(start_y).at(start_x);
-//     TerrainTile *target_tile = &tiles.at(target_y).at(target_x);
-//
-//     // Define maps and priority queue
-//     std::unordered_map<TerrainTile*, TerrainTile*> parent_map;
-//     std::unordered_map<TerrainTile*, float> g_score;  // Cost from start to current
-//     std::unordered_map<TerrainTile*, float> f_score;  // Estimated total cost (g_score + heuristic)
-//
-//     // Priority queue using f_score
-//     std::priority_queue<std::pair<float, TerrainTile*>,
-//                        std::vector<std::pair<float, TerrainTile*>>,
-//                        std::greater<std::pair<float, TerrainTile*>>> open_set;
-//
-//     // Heuristic function (Euclidean distance)
-//     auto heuristic = [target_tile](TerrainTile* tile) {
-//         float dx = tile->position_x - target_tile->position_x;
-//         float dy = tile->position_y - target_tile->position_y;
-//         return std::sqrt(dx*dx + dy*dy);
-//     };
-//
-//     // Initialize scores
-//     for (auto &row : tiles) {
-//         for (TerrainTile &tile : row) {
-//             g_score[&tile] = std::numeric_limits<float>::max();
-//             f_score[&tile] = std::numeric_limits<float>::max();
-//         }
-//     }
-//
-//     g_score[start_tile] = 0;
-//     f_score[start_tile] = heuristic(start_tile);
-//     open_set.push({f_score[start_tile], start_tile});
-//
-//     while (!open_set.empty()) {
-//         auto [current_f, current_tile] = open_set.top();
-//         open_set.pop();
-//
-//         if (current_tile == target_tile) break;
-//
-//         for (TerrainTile *neighbor : current_tile->exits) {
-//             // Tentative g_score is the distance from start to the neighbor through current
-//             float tentative_g_score = g_score[current_tile] + neighbor->cost;
-//
-//             if (tentative_g_score < g_score[neighbor]) {
-//                 parent_map[neighbor] = current_tile;
-//                 g_score[neighbor] = tentative_g_score;
-//                 f_score[neighbor] = g_score[neighbor] + heuristic(neighbor);
-//
-//                 // Add to open set if not already there
-//                 open_set.push({f_score[neighbor], neighbor});
-//             }
-//         }
-//     }
-//
-//     // Reconstruct path
-//     vector<vec2> route;
-//     TerrainTile *tile = target_tile;
-//
-//     if (g_score[target_tile] != std::numeric_limits<float>::max()) {
-//         while (tile != nullptr) {
-//             route.push_back(vec2((float)tile->position_x * sprite_size,
-//                                (float)tile->position_y * sprite_size));
-//             tile = parent_map[tile];
-//         }
-//         std::reverse(route.begin(), route.end());
-//     }
-//
-//     return route;
-// }
-
-// Resultaat: Zelfde snelheid als BFS (speedup 1.0 vs 1.0 origineel)
-// // Use Dijkstra's algorithm to find shortest route to the destination
-// // BIG O: O(n^2)
-// vector<vec2> Terrain::get_route(const Tank &tank, const vec2 &target) {
-//   // Convert positions to tile coordinates
-//   const size_t start_x = tank.position.x / sprite_size;
-//   const size_t start_y = tank.position.y / sprite_size;
-//   const size_t target_x = target.x / sprite_size;
-//   const size_t target_y = target.y / sprite_size;
-
-//   TerrainTile *start_tile = &tiles.at(start_y).at(start_x);
-//   TerrainTile *target_tile = &tiles.at(target_y).at(target_x);
-
-//   // Define maps and priority queue
-//   std::unordered_map<TerrainTile *, TerrainTile *> parent_map;
-//   std::unordered_map<TerrainTile *, int> distance;
-//   std::priority_queue<std::pair<int, TerrainTile *>,
-//                       std::vector<std::pair<int, TerrainTile *>>,
-//                       std::greater<std::pair<int, TerrainTile *>>>
-//       pq;
-
-//   // Initialize distances
-//   for (auto &row : tiles) {
-//     for (TerrainTile &tile : row) {
-//       distance[&tile] = std::numeric_limits<int>::max();
-//     }
-//   }
-
-//   distance[start_tile] = 0;
-//   pq.push({0, start_tile});
-
-//   while (!pq.empty()) {
-//     auto [current_cost, current_tile] = pq.top();
-//     pq.pop();
-
-//     if (current_tile == target_tile)
-//       break;
-
-//     for (TerrainTile *neighbor : current_tile->exits) {
-//       int new_cost = current_cost + neighbor->cost;
-//       if (new_cost < distance[neighbor]) {
-//         distance[neighbor] = new_cost;
-//         parent_map[neighbor] = current_tile;
-//         pq.push({new_cost, neighbor});
-//       }
-//     }
-//   }
-
-//   vector<vec2> route;
-//   TerrainTile *tile = target_tile;
-
-//   if (distance[target_tile] != std::numeric_limits<int>::max()) {
-//     while (tile != nullptr) {
-//       route.push_back(vec2((float)tile->position_x * sprite_size,
-//                          (float)tile->position_y * sprite_size));
-//       tile = parent_map[tile];
-//     }
-//     std::reverse(route.begin(), route.end());
-//   }
-
-//   return route;
-// }
-
-// Use Breadth-first search to find shortest route to the destination
-vector<vec2> Terrain::get_route(const Tank &tank, const vec2 &target) {
-  // Find start and target tile
-  const size_t pos_x = tank.position.x / sprite_size;
-  const size_t pos_y = tank.position.y / sprite_size;
-
-  const size_t target_x = target.x / sprite_size;
-  const size_t target_y = target.y / sprite_size;
-
-  // Init queue with start tile
-  std::queue<vector<TerrainTile *>> queue;
-  queue.emplace();
-  queue.back().push_back(&tiles.at(pos_y).at(pos_x));
-
-  std::vector<TerrainTile *> visited;
-
-  bool route_found = false;
-  vector<TerrainTile *> current_route;
-  while (!queue.empty() && !route_found) {
-    current_route = queue.front();
-    queue.pop();
-    TerrainTile *current_tile = current_route.back();
-
-    // Check all exits, if target then done, else if unvisited push a new
-    // partial route
-    for (TerrainTile *exit : current_tile->exits) {
-      if (exit->position_x == target_x && exit->position_y == target_y) {
-        current_route.push_back(exit);
-        route_found = true;
+// Routes are searched on the flat path grid, see PathGrid for BFS, Dijkstra,
+// A* and jump point search. The search itself allocates nothing, only the
+// returned route does. Dijkstra and A* weigh the tiles by cost, BFS and jump
+// point search only count them.
+vector<vec2> Terrain::get_route(const vec2 &start, const vec2 &target,
+                                SearchContext &context,
+                                SearchAlgorithm algorithm) const {
+  std::vector<vec2> route;
+  if (path_grid.find_route(context, tile_at(start), tile_at(target), algorithm,
+                           context.route_tiles)) {
+    to_positions(context, route);
+  }
+
+  return route;
+}
+
+// Simplified first, so a tank drives straight where it can instead of
+// switching targets on every tile. Convert route to vec2 to prevent dangling
+// pointers.
+void Terrain::to_positions(SearchContext &context,
+                           std::vector<vec2> &route) const {
+  path_grid.simplify_route(context, context.route_tiles);
+  route.clear();
+  route.reserve(context.route_tiles.size());
+  for (int tile : context.route_tiles) {
+    route.push_back(tile_position(tile));
+  }
+}
+
+vector<vec2> Terrain::get_route(const vec2 &start, const vec2 &target,
+                                SearchAlgorithm algorithm) {
+  return get_route(start, target, search_context, algorithm);
+}
+
+int Terrain::tile_at(const vec2 &position) const {
+  const int pos_x = clamp((int)(position.x / sprite_size), 0, width - 1);
+  const int pos_y = clamp((int)(position.y / sprite_size), 0, height - 1);
+  return path_grid.tile_index(pos_x, pos_y);
+}
+
+vec2 Terrain::tile_position(int tile) const {
+  return vec2((float)(tile % width) * sprite_size,
+              (float)(tile / width) * sprite_size);
+}
+
+// One reverse Dijkstra per target tile, kept for every later route to that
+// tile.
+// Expects flow_field_mutex to be locked.
+FlowField &Terrain::get_flow_field(int target) {
+  auto cached = flow_fields.find(target);
+  if (cached != flow_fields.end())
+    return cached->second;
+
+  FlowField &field = flow_fields[target];
+  path_grid.build_flow_field(search_context, target, field,
+                             flow_field_algorithm);
+  return field;
+}
+
+void Terrain::set_flow_field_algorithm(SearchAlgorithm algorithm) {
+  std::lock_guard<std::mutex> lock(flow_field_mutex);
+  flow_field_algorithm = algorithm;
+  flow_fields.clear();
+}
+
+void Terrain::follow_flow_field(const FlowField &field, int start,
+                                SearchContext &context,
+                                std::vector<vec2> &route) const {
+  std::vector<int> &route_tiles = context.route_tiles;
+  route_tiles.clear();
+  if (field.next[start] != -1) {
+    int tile = start;
+    while (true) {
+      route_tiles.push_back(tile);
+      if (field.next[tile] == tile)
         break;
-      }
-      if (!exit->visited) {
-        exit->visited = true;
-        visited.push_back(exit);
-        queue.push(current_route);
-        queue.back().push_back(exit);
-      }
+      tile = field.next[tile];
     }
   }
+  to_positions(context, route);
+}
 
-  // Reset tiles
-  for (TerrainTile *tile : visited) {
-    tile->visited = false;
+vector<vec2> Terrain::get_flow_route(const vec2 &start, const vec2 &target) {
+  std::lock_guard<std::mutex> lock(flow_field_mutex);
+
+  std::vector<vec2> route;
+  follow_flow_field(get_flow_field(tile_at(target)), tile_at(start),
+                    search_context, route);
+  return route;
+}
+
+vector<vec2> Terrain::get_hierarchical_route(const vec2 &start,
+                                             const vec2 &target) {
+  std::vector<vec2> waypoints;
+  if (sector_graph.find_route(path_grid, search_context, tile_at(start),
+                              tile_at(target), waypoint_tiles)) {
+    waypoints.reserve(waypoint_tiles.size());
+    for (size_t i = 1; i < waypoint_tiles.size(); i++) {
+      waypoints.push_back(tile_position(waypoint_tiles[i]));
+    }
+  }
+  return waypoints;
+}
+
+// A leg normally lies inside the sector of its end. The tank may have been
+// pushed out of it, then the search is not limited to the sector.
+void Terrain::refine_route(const vec2 &from, const vec2 &to,
+                           vector<vec2> &route) {
+  const int start = tile_at(from);
+  const int target = tile_at(to);
+  const int sector = sector_graph.sector_of(target);
+  std::vector<int> &leg_tiles = search_context.route_tiles;
+
+  bool found = sector_graph.sector_of(start) == sector &&
+               path_grid.find_route_in_area(search_context, start, target,
+                                            sector_graph.get_sector_area(sector),
+                                            leg_tiles);
+  if (!found) {
+    found = path_grid.find_route(search_context, start, target,
+                                 SearchAlgorithm::A_STAR, leg_tiles);
   }
 
-  if (route_found) {
-    // Convert route to vec2 to prevent dangling pointers
-    std::vector<vec2> route;
-    for (TerrainTile *tile : current_route) {
-      route.push_back(vec2((float)tile->position_x * sprite_size,
-                           (float)tile->position_y * sprite_size));
+  route.clear();
+  if (found) {
+    path_grid.simplify_route(search_context, leg_tiles);
+    for (size_t i = 1; i < leg_tiles.size(); i++) {
+      route.push_back(tile_position(leg_tiles[i]));
     }
+  }
+}
+
+// Split count items into one consecutive range per hardware thread,
+// body(task, begin, end) runs on the pool and task indexes thread_contexts
+template <typename Body>
+static void run_parallel(ThreadPool &pool, std::vector<SearchContext> &contexts,
+                         int count, const Body &body) {
+  const int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  const int per_thread = (count + num_threads - 1) / num_threads;
+  const int num_tasks = (per_thread > 0) ? (count + per_thread - 1) / per_thread : 0;
+
+  if ((int)contexts.size() < num_tasks) {
+    contexts.resize(num_tasks);
+  }
 
-    return route;
+  std::vector<std::future<void>> futures;
+  for (int task = 0; task < num_tasks; task++) {
+    const int begin = task * per_thread;
+    const int end = std::min(begin + per_thread, count);
+    futures.push_back(
+        pool.enqueue([&body, task, begin, end]() { body(task, begin, end); }));
   }
-  return std::vector<vec2>();
 
+  for (auto &future : futures) {
+    future.wait();
+  }
+}
+
+// The flow field map is only modified before the tasks start: every missing
+// field gets its (empty) entry first, so the tasks can fill and read the
+// entries without locking.
+void Terrain::cache_flow_fields(const TankStore &tanks, ThreadPool &pool) {
+  std::lock_guard<std::mutex> lock(flow_field_mutex);
+
+  missing_targets.clear();
+  for (int tank = 0; tank < tanks.size(); tank++) {
+    const int target = tile_at(tanks.get_destination(tank));
+    if (flow_fields.find(target) == flow_fields.end()) {
+      flow_fields[target];
+      missing_targets.push_back(target);
+    }
+  }
+
+  run_parallel(pool, thread_contexts, (int)missing_targets.size(),
+               [this](int task, int begin, int end) {
+                 for (int i = begin; i < end; i++) {
+                   const int target = missing_targets[i];
+                   path_grid.build_flow_field(thread_contexts[task], target,
+                                              flow_fields.find(target)->second,
+                                              flow_field_algorithm);
+                 }
+               });
+}
+
+void Terrain::get_routes(const TankStore &tanks, ThreadPool &pool,
+                         std::vector<std::vector<vec2>> &routes) {
+  cache_flow_fields(tanks, pool);
+
+  std::lock_guard<std::mutex> lock(flow_field_mutex);
+  routes.resize(tanks.size());
+  run_parallel(pool, thread_contexts, tanks.size(),
+               [this, &tanks, &routes](int task, int begin, int end) {
+                 for (int tank = begin; tank < end; tank++) {
+                   const int target = tile_at(tanks.get_destination(tank));
+                   const FlowField &field = flow_fields.find(target)->second;
+                   follow_flow_field(field, tile_at(tanks.get_position(tank)),
+                                     thread_contexts[task], routes[tank]);
+                 }
+               });
 }
 
-// TODO: See if I can delete this if not used ?? (Berend)
-// TODO: Function not used, convert BFS to dijkstra and take speed into account
-// next year :)
-// float Terrain::get_speed_modifier(const vec2 &position) const {
-//   const size_t pos_x = position.x / sprite_size;
-//   const size_t pos_y = position.y / sprite_size;
-
-//   switch (tiles.at(pos_y).at(pos_x).tile_type) {
-//   case TileType::GRASS:
-//     return 1.0f;
-//     break;
-//   case TileType::FORREST:
-//     return 0.5f;
-//     break;
-//   case TileType::ROCKS:
-//     return 0.75f;
-//     break;
-//   case TileType::MOUNTAINS:
-//     return 0.0f;
-//     break;
-//   case TileType::WATER:
-//     return 0.0f;
-//     break;
-//   default:
-//     return 1.0f;
-//     break;
-//   }
-// }
+uint64_t Terrain::get_content_hash() const {
+  const int size[2] = {width, height};
+  return RouteCache::hash_bytes(tiles.data(), tiles.size() * sizeof(TileType),
+                                RouteCache::hash_bytes(size, sizeof(size)));
+}
+
+// Speed on the tile under the position, positions off the map use the
+// nearest tile on the border
+float Terrain::get_speed_modifier(const vec2 &position) const {
+  const int pos_x = clamp((int)(position.x / sprite_size), 0, width - 1);
+  const int pos_y = clamp((int)(position.y / sprite_size), 0, height - 1);
+
+  switch (tiles[pos_y * width + pos_x]) {
+  case TileType::GRASS:
+    return 1.0f;
+    break;
+  case TileType::FORREST:
+    return 0.5f;
+    break;
+  case TileType::ROCKS:
+    return 0.75f;
+    break;
+  case TileType::MOUNTAINS:
+    return 0.0f;
+    break;
+  case TileType::WATER:
+    return 0.0f;
+    break;
+  default:
+    return 1.0f;
+    break;
+  }
+}
+
+// Time to cross a tile, the inverse of the speed modifier scaled to integers
+// (grass 1.0 -> 3, rocks 0.75 -> 4, forest 0.5 -> 6)
+int Terrain::tile_cost(TileType tile_type) {
+  switch (tile_type) {
+  case TileType::GRASS:
+    return 3;
+  case TileType::FORREST:
+    return 6;
+  case TileType::ROCKS:
+    return 4;
+  default:
+    return 0; // Inaccessible
+  }
+}
 
 bool Terrain::is_accessible(int y, int x) {
   // Bounds check
-  if ((x >= 0 && x < terrain_width) && (y >= 0 && y < terrain_height)) {
+  if ((x >= 0 && x < width) && (y >= 0 && y < height)) {
     // Inaccessible terrain check
-    if (tiles.at(y).at(x).tile_type != TileType::MOUNTAINS &&
-        tiles.at(y).at(x).tile_type != TileType::WATER) {
+    if (is_passable_tile(tiles[y * width + x])) {
       return true;
     }
   }
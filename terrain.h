@@ -2,41 +2,116 @@
 
 #include <cstddef>
 namespace Tmpl8 {
-enum TileType { GRASS, FORREST, ROCKS, MOUNTAINS, WATER };
+// Stored as is in binary map files, one byte per tile
+enum TileType : uint8_t { GRASS, FORREST, ROCKS, MOUNTAINS, WATER };
 
-class TerrainTile {
-public:
-  // TerrainTile *up, *down, *left, *right;
-  vector<TerrainTile *> exits;
-  bool visited = false;
-
-  size_t position_x;
-  size_t position_y;
-
-  TileType tile_type;
-  int cost;
+inline bool is_passable_tile(TileType tile_type) {
+  return tile_type != TileType::MOUNTAINS && tile_type != TileType::WATER;
+}
 
-private:
+// Tiles whose route to the target tile changed, see Terrain::update. The
+// field of the target was built again when rebuilt is set, then tiles is
+// empty and any route to it may have changed.
+struct RouteChange {
+  int target;
+  bool rebuilt;
+  std::vector<int> tiles;
 };
 
 class Terrain {
 public:
+  // Loads assets/terrain.map, or assets/terrain.txt when there is no binary
+  // map (see MapFile::convert_text_map to create one)
   Terrain();
 
+  // Applies the queued tile edits. Only the sectors around the tiles are
+  // rebuilt, and the cached flow fields are repaired where they lead over
+  // the tiles, in time proportional to the change rather than the map.
   void update();
   void draw(Surface *target) const;
 
-  // Use Breadth-first search to find shortest route to the destination
-  vector<vec2> get_route(const Tank &tank, const vec2 &target);
+  // Queue a tile change for the next update
+  void set_tile(size_t x, size_t y, TileType tile_type);
+  bool has_pending_edits() const { return !pending_edits.empty(); }
+
+  // Per cached flow field, the tiles whose route changed in the last update
+  const std::vector<RouteChange> &get_route_changes() const {
+    return route_changes;
+  }
+
+  // Find the fastest route to the destination, A* by default. JUMP_POINT
+  // gives the route with the fewest tiles, like BFS, but expands far less
+  // once enable_jump_point_search was called (BFS until then).
+  // Every route is simplified to the tiles where it turns (see
+  // PathGrid::simplify_route), tanks drive straight between them.
+  // Re-entrant, as long as every thread passes its own context
+  vector<vec2> get_route(const vec2 &start, const vec2 &target,
+                         SearchContext &context,
+                         SearchAlgorithm algorithm = SearchAlgorithm::A_STAR) const;
+  // Uses the context of the terrain, one thread at a time
+  vector<vec2> get_route(const vec2 &start, const vec2 &target,
+                         SearchAlgorithm algorithm = SearchAlgorithm::A_STAR);
+
+  // Same kind of route, taken from the cached flow field of the target tile.
+  // The first request for a target runs one reverse Dijkstra over the whole
+  // map, after that every route costs O(route length). Thread safe.
+  vector<vec2> get_flow_route(const vec2 &start, const vec2 &target);
+
+  // Hierarchical route: waypoints (entrances between sectors) up to and
+  // including the target, without the start. Meant for large maps, where a
+  // full route per tank is too slow; refine_route fills in one leg at a time.
+  vector<vec2> get_hierarchical_route(const vec2 &start, const vec2 &target);
+  // Tile route of one leg, from (excluded) to (included)
+  void refine_route(const vec2 &from, const vec2 &to, vector<vec2> &route);
+
+  // Keep the jump distances of jump point search, off by default since the
+  // game itself routes with flow fields. Tile edits update them from then on.
+  void enable_jump_point_search() { path_grid.enable_jump_points(); }
 
+  // DIJKSTRA (the default) builds flow fields by tile cost, BFS counts tiles
+  // with the bit-parallel BFS. Drops the cached fields.
+  void set_flow_field_algorithm(SearchAlgorithm algorithm);
+  SearchAlgorithm get_flow_field_algorithm() const {
+    return flow_field_algorithm;
+  }
+
+  // Flow routes for all tanks at once (indexed like the tanks). Missing flow
+  // fields and the routes themselves are spread over the thread pool.
+  void get_routes(const TankStore &tanks, ThreadPool &pool,
+                  std::vector<std::vector<vec2>> &routes);
+  // Only build the missing flow fields towards the tank destinations
+  void cache_flow_fields(const TankStore &tanks, ThreadPool &pool);
+
+  // 1 on grass, less in forests and on rocks, 0 on impassable tiles
   float get_speed_modifier(const vec2 &position) const;
 
+  // Hash of the size and all tiles, changes whenever a tile does
+  uint64_t get_content_hash() const;
+
+  // Size of the terrain in pixels
+  vec2 get_size() const {
+    return vec2((float)(width * sprite_size), (float)(height * sprite_size));
+  }
+
+  // Index of the tile under a position (the nearest edge tile for positions
+  // off the map), and the top left corner of a tile
+  int tile_at(const vec2 &position) const;
+  vec2 tile_position(int tile) const;
+  float get_tile_size() const { return (float)sprite_size; }
+
 private:
   bool is_accessible(int y, int x);
+  static int tile_cost(TileType tile_type);
+  FlowField &get_flow_field(int target);
+  void follow_flow_field(const FlowField &field, int start,
+                         SearchContext &context,
+                         std::vector<vec2> &route) const;
+  void to_positions(SearchContext &context, std::vector<vec2> &route) const;
 
   static constexpr int sprite_size = 16;
-  static constexpr size_t terrain_width = 80;
-  static constexpr size_t terrain_height = 45;
+  static constexpr int sector_size = 10; // In tiles
+  static constexpr int default_width = 80;   // Without a map file
+  static constexpr int default_height = 45;
 
   std::unique_ptr<Surface> grass_img;
   std::unique_ptr<Surface> forest_img;
@@ -50,6 +125,32 @@ private:
   std::unique_ptr<Sprite> tile_mountains;
   std::unique_ptr<Sprite> tile_water;
 
-  std::array<std::array<TerrainTile, terrain_width>, terrain_height> tiles;
+  // Size in tiles, read from the map file
+  int width = 0;
+  int height = 0;
+  std::vector<TileType> tiles; // y * width + x
+
+  // Flat copy of the tiles for path planning
+  PathGrid path_grid;
+  SearchContext search_context;
+  std::vector<SearchContext> thread_contexts; // One per parallel task
+  SectorGraph sector_graph;
+  std::vector<int> waypoint_tiles;
+
+  // Flow fields by target tile index (y * width + x), guarded by
+  // flow_field_mutex
+  std::unordered_map<int, FlowField> flow_fields;
+  std::vector<int> missing_targets;
+  SearchAlgorithm flow_field_algorithm = SearchAlgorithm::DIJKSTRA;
+  std::mutex flow_field_mutex;
+
+  struct TileEdit {
+    int tile;
+    TileType tile_type;
+  };
+  std::vector<TileEdit> pending_edits;
+  std::vector<int> edited_tiles;
+  std::vector<int> affected_tiles;
+  std::vector<RouteChange> route_changes;
 };
 } // namespace Tmpl8
@@ -0,0 +1,50 @@
+#include "precomp.h"
+#include "timing_wheel.h"
+
+namespace Tmpl8 {
+
+void TimingWheel::schedule(int item, uint32_t delay) {
+  assert(delay > 0 && delay < max_delay);
+  insert({item, tick + delay});
+}
+
+// The lowest level whose slots span the delay, slot by the expiry bits of
+// that level
+void TimingWheel::insert(const Timer &timer) {
+  const uint32_t delay = timer.expiry - tick;
+  int level = 0;
+  while (level + 1 < num_levels && delay >> (slot_bits * (level + 1)) != 0) {
+    level++;
+  }
+  const int slot = (timer.expiry >> (slot_bits * level)) & (num_slots - 1);
+  slots[level][slot].push_back(timer);
+}
+
+// Higher levels first, their items may land in the level below that is
+// spread next. Items due now land in the current slot of level 0.
+void TimingWheel::advance(std::vector<int> &fired) {
+  tick++;
+
+  int top = 0;
+  while (top + 1 < num_levels &&
+         (tick & ((1u << (slot_bits * (top + 1))) - 1)) == 0) {
+    top++;
+  }
+  for (int level = top; level > 0; level--) {
+    std::vector<Timer> &slot =
+        slots[level][(tick >> (slot_bits * level)) & (num_slots - 1)];
+    cascading.swap(slot);
+    for (const Timer &timer : cascading) {
+      insert(timer);
+    }
+    cascading.clear();
+  }
+
+  std::vector<Timer> &due = slots[0][tick & (num_slots - 1)];
+  for (const Timer &timer : due) {
+    fired.push_back(timer.item);
+  }
+  due.clear();
+}
+
+} // namespace Tmpl8
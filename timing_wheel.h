@@ -0,0 +1,39 @@
+#pragma once
+
+namespace Tmpl8 {
+
+// Hierarchical timing wheel: items fire a given number of ticks after they
+// were scheduled, and a tick only touches the items due. Level 0 has one
+// slot per tick, every level above one slot per full turn of the level
+// below. Whenever a lower level completes a turn the next slot of the level
+// above is spread over the levels below, so an item moves down at most once
+// per level: scheduling and firing are O(1) per item.
+class TimingWheel {
+public:
+  static constexpr int slot_bits = 6;
+  static constexpr int num_slots = 1 << slot_bits;
+  static constexpr int num_levels = 3;
+  static constexpr uint32_t max_delay = 1u << (slot_bits * num_levels);
+
+  // Fire the item delay ticks from now, 0 < delay < max_delay
+  void schedule(int item, uint32_t delay);
+
+  // Next tick, the items due are appended to fired (in no particular order)
+  void advance(std::vector<int> &fired);
+
+  uint32_t get_tick() const { return tick; }
+
+private:
+  struct Timer {
+    int item;
+    uint32_t expiry; // Tick
+  };
+
+  void insert(const Timer &timer);
+
+  std::vector<Timer> slots[num_levels][num_slots];
+  std::vector<Timer> cascading; // Scratch for advance
+  uint32_t tick = 0;
+};
+
+} // namespace Tmpl8